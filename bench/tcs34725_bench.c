@@ -0,0 +1,369 @@
+// Benchmark harness for the TCS34725 driver.
+//
+// Runs every public API call against the simulator (tcs34725_sim.h) for
+// all integration times and gains. The platform functions are wrapped by
+// counting shims, and each call reports:
+//  - bus transactions (read_reg, write_reg and write_byte calls)
+//  - bytes on the bus (command byte plus data)
+//  - time requested through delay_ms
+//  - CPU time spent in the driver (time inside the simulator is excluded)
+//
+// Results are printed as JSON lines, one object per call and setting, so
+// runs from different commits can be diffed or compared with a script.
+//
+// Build: cc -O2 -Iinc src/*.c bench/tcs34725_bench.c -lm -o tcs34725_bench
+
+#define _POSIX_C_SOURCE 199309L
+#include <stdio.h>
+#include <stdbool.h>
+#include <string.h>
+#include <time.h>
+#include "tcs34725.h"
+#include "tcs34725_sim.h"
+
+// Repetitions per measurement, results are averaged
+#define BENCH_ITERATIONS (50)
+// Version of the output format
+#define BENCH_SCHEMA (1)
+
+// Counters maintained by the shims
+typedef struct {
+    uint64_t transactions;
+    uint64_t bytes;
+    uint64_t delay_ms;
+    uint64_t backend_ns;
+} bench_counters_t;
+
+static bench_counters_t counters;
+static tcs34725_sim_t sim;
+
+static uint64_t now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+
+/* Counting shims around the simulator */
+static int8_t shim_read_reg(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    uint64_t start = now_ns();
+    int8_t ret = tcs34725_sim_read_reg(reg_addr, reg_data, len, user_ptr);
+    counters.transactions++;
+    counters.bytes += 1 + len;
+    counters.backend_ns += now_ns() - start;
+    return ret;
+}
+
+static int8_t shim_write_reg(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    uint64_t start = now_ns();
+    int8_t ret = tcs34725_sim_write_reg(reg_addr, reg_data, len, user_ptr);
+    counters.transactions++;
+    counters.bytes += 1 + len;
+    counters.backend_ns += now_ns() - start;
+    return ret;
+}
+
+static int8_t shim_write_byte(uint8_t single_byte, void* user_ptr) {
+    uint64_t start = now_ns();
+    int8_t ret = tcs34725_sim_write_byte(single_byte, user_ptr);
+    counters.transactions++;
+    counters.bytes += 1;
+    counters.backend_ns += now_ns() - start;
+    return ret;
+}
+
+static void shim_delay_ms(uint32_t period) {
+    uint64_t start = now_ns();
+    tcs34725_sim_delay_ms(period);
+    counters.delay_ms += period;
+    counters.backend_ns += now_ns() - start;
+}
+
+static uint32_t shim_get_tick_ms(void) {
+    return tcs34725_sim_get_tick_ms();
+}
+
+
+/* Benchmarked operations */
+typedef tcs34725_err_t (*bench_fptr_t)(tcs34725_config_t*);
+
+static tcs34725_err_t op_init(tcs34725_config_t* config) {
+    // Cold start, the device and the driver state are reset first
+    tcs34725_sim_light_t light = sim.light;
+    tcs34725_sim_init(&sim, TCS34725_ID);
+    tcs34725_sim_set_light(&sim, light);
+    memset(&config->state, 0, sizeof(config->state));
+    return tcs34725_init(config);
+}
+
+static tcs34725_err_t op_enable(tcs34725_config_t* config) {
+    return tcs34725_enable(config);
+}
+
+static tcs34725_err_t op_disable(tcs34725_config_t* config) {
+    return tcs34725_disable(config);
+}
+
+static tcs34725_err_t op_get_raw_data(tcs34725_config_t* config) {
+    tcs34725_color_t color;
+    return tcs34725_get_raw_data(&color, config);
+}
+
+static tcs34725_err_t op_get_raw_data_burst(tcs34725_config_t* config) {
+    tcs34725_color_t color;
+    uint8_t status;
+    return tcs34725_get_raw_data_burst(&color, &status, config);
+}
+
+static tcs34725_err_t op_get_raw_data_one_shot(tcs34725_config_t* config) {
+    tcs34725_color_t color;
+    return tcs34725_get_raw_data_one_shot(&color, config);
+}
+
+static tcs34725_err_t op_get_normalized_RGB(tcs34725_config_t* config) {
+    tcs34725_normalized_color_t color;
+    return tcs34725_get_normalized_RGB(&color, config);
+}
+
+static tcs34725_err_t op_non_blocking_sample(tcs34725_config_t* config) {
+    // start, poll every millisecond until ready, fetch
+    tcs34725_err_t err = TCS34725_OK;
+    tcs34725_color_t color;
+    bool ready = false;
+    err |= tcs34725_start(config);
+    while(err == TCS34725_OK && !ready){
+        err |= tcs34725_poll(&ready, config);
+        if(!ready){
+            config->delay_ms(1);
+        }
+    }
+    err |= tcs34725_fetch(&color, config);
+    return err;
+}
+
+static tcs34725_err_t op_one_shot(tcs34725_config_t* config) {
+    tcs34725_color_t color;
+    return tcs34725_one_shot(&color, NULL, config);
+}
+
+static tcs34725_err_t op_init_warm(tcs34725_config_t* config) {
+    // Host restart, the device keeps running with the settings from the setup call
+    bool warm = false;
+    memset(&config->state, 0, sizeof(config->state));
+    return tcs34725_init_warm(&warm, config);
+}
+
+static tcs34725_err_t op_init_warm_changed(tcs34725_config_t* config) {
+    // Host restart with settings that differ from the ones the device runs with
+    bool warm = false;
+    memset(&config->state, 0, sizeof(config->state));
+    config->settings.gain = (config->settings.gain == TCS34725_GAIN_1X) ? TCS34725_GAIN_4X : TCS34725_GAIN_1X;
+    return tcs34725_init_warm(&warm, config);
+}
+
+static uint32_t cycle_ms(const tcs34725_config_t* config) {
+    // Length of one integration, 2.4ms per cycle rounded up
+    return ((256 - (uint32_t)config->settings.integration_time) * 24 + 9) / 10;
+}
+
+static const tcs34725_event_t event = { .hysteresis_percent = 10, .hysteresis = 10, .persistence = TCS34725_PERS_1_CYCLE, .period_ms = 0 };
+
+static tcs34725_err_t op_event_start(tcs34725_config_t* config) {
+    tcs34725_color_t color;
+    return tcs34725_event_start(&event, &color, config);
+}
+
+static tcs34725_err_t op_event_handle(tcs34725_config_t* config) {
+    // Light step every call so the INT pin fires, then wait one cycle and handle it
+    tcs34725_color_t color;
+    bool changed = false;
+    sim.light.clear = (sim.light.clear == 10.0F) ? 20.0F : 10.0F;
+    config->delay_ms(cycle_ms(config));
+    return tcs34725_event_handle(&color, &changed, &event, config);
+}
+
+static tcs34725_sample_t ring_storage[8];
+static tcs34725_ring_buffer_t ring;
+
+static tcs34725_err_t op_start_continuous(tcs34725_config_t* config) {
+    uint32_t period = 0;
+    return tcs34725_start_continuous(0, &period, config);
+}
+
+static tcs34725_err_t op_service_continuous(tcs34725_config_t* config) {
+    // One sample period, then service and drain the ring buffer
+    tcs34725_sample_t sample;
+    config->delay_ms(config->state.period_ms);
+    tcs34725_err_t err = tcs34725_service_continuous(config);
+    while(tcs34725_ring_pop(config->ring, &sample)){
+    }
+    return err;
+}
+
+static tcs34725_err_t op_agc_update(tcs34725_config_t* config) {
+    // One cycle, burst read and an AGC decision, the settings follow the simulated light
+    const tcs34725_agc_t agc = { .min_counts = 1000, .hysteresis = 20, .max_integration_ms = 0 };
+    tcs34725_color_t color;
+    uint8_t status;
+    bool changed = false;
+    config->delay_ms(cycle_ms(config));
+    tcs34725_err_t err = tcs34725_get_raw_data_burst(&color, &status, config);
+    err |= tcs34725_agc_update(color, &agc, &changed, config);
+    return err;
+}
+
+static tcs34725_err_t setup_event(tcs34725_config_t* config) {
+    tcs34725_color_t color;
+    return tcs34725_event_start(&event, &color, config);
+}
+
+static tcs34725_err_t setup_continuous(tcs34725_config_t* config) {
+    uint32_t period = 0;
+    tcs34725_ring_init(&ring, ring_storage, sizeof(ring_storage) / sizeof(ring_storage[0]));
+    config->ring = &ring;
+    return tcs34725_start_continuous(0, &period, config);
+}
+
+static tcs34725_err_t op_set_interrupt(tcs34725_config_t* config) {
+    return tcs34725_set_interrupt(true, config);
+}
+
+static tcs34725_err_t op_clear_interrupt(tcs34725_config_t* config) {
+    return tcs34725_clear_interrupt(config);
+}
+
+static tcs34725_err_t op_set_int_limits(tcs34725_config_t* config) {
+    return tcs34725_set_int_limits(1000, 20000, config);
+}
+
+static tcs34725_err_t op_set_gain(tcs34725_config_t* config) {
+    return tcs34725_set_gain(config->settings.gain, config);
+}
+
+static tcs34725_err_t op_set_integration_time(tcs34725_config_t* config) {
+    return tcs34725_set_integration_time(config->settings.integration_time, config);
+}
+
+static volatile uint16_t sink;
+
+static tcs34725_err_t op_calculate_color_temperature(tcs34725_config_t* config) {
+    (void)config;
+    sink = tcs34725_calculate_color_temperature((tcs34725_color_t){ 1200, 1500, 1100, 3900 });
+    return TCS34725_OK;
+}
+
+static tcs34725_err_t op_calculate_color_temperature_dn40(tcs34725_config_t* config) {
+    sink = tcs34725_calculate_color_temperature_dn40((tcs34725_color_t){ 1200, 1500, 1100, 3900 }, config);
+    return TCS34725_OK;
+}
+
+static tcs34725_err_t op_calculate_lux(tcs34725_config_t* config) {
+    (void)config;
+    sink = tcs34725_calculate_lux((tcs34725_color_t){ 1200, 1500, 1100, 3900 });
+    return TCS34725_OK;
+}
+
+typedef struct {
+    const char*  name;
+    bench_fptr_t run;
+    bench_fptr_t setup;  // Called once after tcs34725_init and before the counters start (optional)
+} bench_op_t;
+
+static const bench_op_t ops[] = {
+    { "init",                              op_init,                             NULL },
+    { "init_warm",                         op_init_warm,                        NULL },
+    { "init_warm_changed",                 op_init_warm_changed,                NULL },
+    { "enable",                            op_enable,                           NULL },
+    { "disable",                           op_disable,                          NULL },
+    { "get_raw_data",                      op_get_raw_data,                     NULL },
+    { "get_raw_data_burst",                op_get_raw_data_burst,               NULL },
+    { "get_raw_data_one_shot",             op_get_raw_data_one_shot,            NULL },
+    { "one_shot",                          op_one_shot,                         NULL },
+    { "get_normalized_RGB",                op_get_normalized_RGB,               NULL },
+    { "start_poll_fetch",                  op_non_blocking_sample,              NULL },
+    { "start_continuous",                  op_start_continuous,                 setup_continuous },
+    { "service_continuous",                op_service_continuous,               setup_continuous },
+    { "event_start",                       op_event_start,                      NULL },
+    { "event_handle",                      op_event_handle,                     setup_event },
+    { "agc_update",                        op_agc_update,                       NULL },
+    { "set_interrupt",                     op_set_interrupt,                    NULL },
+    { "clear_interrupt",                   op_clear_interrupt,                  NULL },
+    { "set_int_limits",                    op_set_int_limits,                   NULL },
+    { "set_gain",                          op_set_gain,                         NULL },
+    { "set_integration_time",              op_set_integration_time,             NULL },
+    { "calculate_color_temperature",       op_calculate_color_temperature,      NULL },
+    { "calculate_color_temperature_dn40",  op_calculate_color_temperature_dn40, NULL },
+    { "calculate_lux",                     op_calculate_lux,                    NULL },
+};
+
+static const struct {
+    const char*                 name;
+    tcs34725_integration_time_t value;
+} times[] = {
+    { "2.4ms", TCS34725_INTEGRATIONTIME_2_4MS },
+    { "24ms",  TCS34725_INTEGRATIONTIME_24MS },
+    { "50ms",  TCS34725_INTEGRATIONTIME_50MS },
+    { "101ms", TCS34725_INTEGRATIONTIME_101MS },
+    { "154ms", TCS34725_INTEGRATIONTIME_154MS },
+    { "700ms", TCS34725_INTEGRATIONTIME_700MS },
+};
+
+static const struct {
+    const char*     name;
+    tcs34725_gain_t value;
+} gains[] = {
+    { "1x",  TCS34725_GAIN_1X },
+    { "4x",  TCS34725_GAIN_4X },
+    { "16x", TCS34725_GAIN_16X },
+    { "60x", TCS34725_GAIN_60X },
+};
+
+
+static void bench(const bench_op_t* op, size_t t, size_t g) {
+    tcs34725_config_t config;
+    memset(&config, 0, sizeof(config));
+    tcs34725_sim_init(&sim, TCS34725_ID);
+    tcs34725_sim_set_light(&sim, (tcs34725_sim_light_t){ .red = 3.0F, .green = 4.0F, .blue = 3.0F, .clear = 10.0F });
+    tcs34725_err_t err = tcs34725_sim_attach(&sim, &config);
+    config.read_reg = shim_read_reg;
+    config.write_reg = shim_write_reg;
+    config.write_byte = shim_write_byte;
+    config.delay_ms = shim_delay_ms;
+    config.get_tick_ms = shim_get_tick_ms;
+    config.settings.integration_time = times[t].value;
+    config.settings.gain = gains[g].value;
+
+    err |= tcs34725_init(&config);
+    if(op->setup != NULL){
+        err |= op->setup(&config);
+    }
+
+    memset(&counters, 0, sizeof(counters));
+    uint64_t start = now_ns();
+    for(int i = 0; i < BENCH_ITERATIONS; i++){
+        err |= op->run(&config);
+    }
+    uint64_t total_ns = now_ns() - start;
+    uint64_t driver_ns = (total_ns > counters.backend_ns) ? total_ns - counters.backend_ns : 0;
+
+    printf("{\"schema\":%d,\"api\":\"%s\",\"integration_time\":\"%s\",\"gain\":\"%s\","
+           "\"transactions\":%.2f,\"bytes\":%.2f,\"delay_ms\":%.2f,\"cpu_ns\":%.1f,\"ok\":%s}\n",
+           BENCH_SCHEMA, op->name, times[t].name, gains[g].name,
+           (double)counters.transactions / BENCH_ITERATIONS,
+           (double)counters.bytes / BENCH_ITERATIONS,
+           (double)counters.delay_ms / BENCH_ITERATIONS,
+           (double)driver_ns / BENCH_ITERATIONS,
+           (err == TCS34725_OK) ? "true" : "false");
+}
+
+
+int main(void) {
+    for(size_t o = 0; o < sizeof(ops) / sizeof(ops[0]); o++){
+        for(size_t t = 0; t < sizeof(times) / sizeof(times[0]); t++){
+            for(size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++){
+                bench(&ops[o], t, g);
+            }
+        }
+    }
+    return 0;
+}
@@ -16,26 +16,88 @@ extern "C" {
 
 // Initialize driver and check that device is attached
 tcs34725_err_t tcs34725_init(tcs34725_config_t*);
+// Same as above but reuses the device state if it kept power (warm is set when no register write or wait was needed)
+tcs34725_err_t tcs34725_init_warm(bool* warm, tcs34725_config_t*);
 // Wake device from sleep state
 tcs34725_err_t tcs34725_enable(tcs34725_config_t*);
 // Place device into sleep state
 tcs34725_err_t tcs34725_disable(tcs34725_config_t*);
 
+// Forget the register shadow copy (call after the sensor lost power or was written by someone else)
+void tcs34725_invalidate_cache(tcs34725_config_t*);
+
 // Useful for changing config and simultaneously writing changes to device
 tcs34725_err_t tcs34725_set_integration_time(tcs34725_integration_time_t, tcs34725_config_t*);
 tcs34725_err_t tcs34725_set_gain(tcs34725_gain_t, tcs34725_config_t*);
 
+// Automatic gain control, selects the next gain/integration time from the last sample
+tcs34725_err_t tcs34725_agc_update(tcs34725_color_t, const tcs34725_agc_t*, bool* changed, tcs34725_config_t*);
+
 // Get normalized RGB reading (returns 3xfloat from 0-255)
 tcs34725_err_t tcs34725_get_normalized_RGB(tcs34725_normalized_color_t*, tcs34725_config_t*);
 // Samples raw data
 tcs34725_err_t tcs34725_get_raw_data(tcs34725_color_t*, tcs34725_config_t*);
+// Samples raw data (and optionally the status register) in a single bus transaction without delaying
+tcs34725_err_t tcs34725_get_raw_data_burst(tcs34725_color_t*, uint8_t* status, tcs34725_config_t*);
 // Wakes the device, samples raw data and sleeps the device
 tcs34725_err_t tcs34725_get_raw_data_one_shot(tcs34725_color_t*, tcs34725_config_t*);
+// Same as above with the minimum wait (PON warm-up plus one integration, ended by AVALID), reports the time taken
+tcs34725_err_t tcs34725_one_shot(tcs34725_color_t*, uint32_t* time_to_sample_ms, tcs34725_config_t*);
+
+// Non-blocking acquisition (requires get_tick_ms). Start once, then poll until ready and fetch each sample
+tcs34725_err_t tcs34725_start(tcs34725_config_t*);
+tcs34725_err_t tcs34725_poll(bool* ready, tcs34725_config_t*);
+tcs34725_err_t tcs34725_fetch(tcs34725_color_t*, tcs34725_config_t*);
+// Milliseconds until tcs34725_poll has bus work to do (0 = poll now)
+uint32_t tcs34725_next_poll_ms(tcs34725_config_t*);
+
+// Continuous acquisition using the wait timer, samples are pushed to config->ring by the service call.
+// Stop with tcs34725_disable
+tcs34725_err_t tcs34725_start_continuous(uint32_t period_ms, uint32_t* actual_period_ms, tcs34725_config_t*);
+tcs34725_err_t tcs34725_service_continuous(tcs34725_config_t*);
+
+// Event mode: the device interrupts only when the clear channel leaves a window around the last value.
+// Start returns the first sample, call handle when the INT pin asserts (changed is set when the window moved).
+// Start rejects TCS34725_PERS_NONE (interrupt on every cycle) with TCS34725_ERR_INVALID_ARG.
+// Stop with tcs34725_disable
+tcs34725_err_t tcs34725_event_start(const tcs34725_event_t*, tcs34725_color_t*, tcs34725_config_t*);
+tcs34725_err_t tcs34725_event_handle(tcs34725_color_t*, bool* changed, const tcs34725_event_t*, tcs34725_config_t*);
+
+// Sample ring buffer helpers
+void tcs34725_ring_init(tcs34725_ring_buffer_t*, tcs34725_sample_t* storage, uint16_t capacity);
+bool tcs34725_ring_pop(tcs34725_ring_buffer_t*, tcs34725_sample_t*);
 
 //Conversion helpers
 uint16_t tcs34725_calculate_color_temperature(tcs34725_color_t);
 uint16_t tcs34725_calculate_color_temperature_dn40(tcs34725_color_t, tcs34725_config_t*);
 uint16_t tcs34725_calculate_lux(tcs34725_color_t);
+// Clear channel count at which samples are considered saturated (includes the 75% ripple margin below 154ms)
+uint16_t tcs34725_calculate_saturation(tcs34725_integration_time_t);
+
+// DN40 color temperature with the saturation threshold already computed (0 when saturated or invalid).
+// Shared by tcs34725_calculate_color_temperature_dn40, the batch and plan conversions and the C++ wrapper
+static inline uint16_t tcs34725_dn40(tcs34725_color_t color, uint16_t saturation) {
+    // AMS RGB sensors have no IR channel, so the IR content must be calculated indirectly
+    uint32_t sum = (uint32_t)color.red + color.green + color.blue;
+    uint16_t ir = (sum > color.clear) ? (uint16_t)((sum - color.clear) / 2) : 0;
+
+    // Remove the IR component from the raw RGB values (wraps around like the original uint16_t arithmetic)
+    uint16_t r2 = (uint16_t)(color.red - ir);
+    uint16_t b2 = (uint16_t)(color.blue - ir);
+    if (color.clear == 0 || color.clear >= saturation || r2 == 0) {
+        return 0;
+    }
+
+    /* A simple method of measuring color temp is to use the ratio of blue
+       to red light, taking IR cancellation into account. */
+    return (uint16_t)((3810 * (uint32_t)b2) / (uint32_t)r2 + 1391);
+}
+
+// Fixed point conversion helpers (define TCS34725_FIXED_POINT to use them for the functions above as well)
+tcs34725_err_t tcs34725_get_normalized_RGB_fixed(tcs34725_normalized_color_fixed_t*, tcs34725_config_t*);
+void tcs34725_calculate_normalized_RGB_fixed(tcs34725_color_t, tcs34725_normalized_color_fixed_t*);
+uint16_t tcs34725_calculate_color_temperature_fixed(tcs34725_color_t);
+uint16_t tcs34725_calculate_lux_fixed(tcs34725_color_t);
 
 // Configure interrupts
 tcs34725_err_t tcs34725_set_interrupt(bool, tcs34725_config_t*);
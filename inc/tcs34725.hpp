@@ -0,0 +1,171 @@
+// Header-only C++ front end with compile-time settings.
+//
+// The bus type, integration time and gain are template parameters, so the
+// integration delay, saturation threshold and scale factors are constants
+// and bus calls are direct (inlinable) member calls instead of going
+// through the function pointers of tcs34725_config_t. Nothing allocates and
+// nothing is virtual. Register definitions are shared with the C driver.
+//
+// A bus type provides:
+//   int8_t read(uint8_t command, uint8_t* data, uint32_t len);         // 0 = success
+//   int8_t write(uint8_t command, const uint8_t* data, uint32_t len);  // 0 = success (len may be 0)
+//   void delay_ms(uint32_t period);
+// where command is a complete command byte (TCS34725_COMMAND_FORMAT).
+// tcs34725::ConfigBus adapts the platform functions of an existing config.
+//
+// Requires C++11.
+
+#ifndef TCS34725_HPP
+#define TCS34725_HPP
+
+#include "tcs34725.h"
+
+namespace tcs34725 {
+
+// Bus implemented by the platform functions of a C config
+// (read_reg/write_reg take bare register addresses, write_byte the complete command byte)
+class ConfigBus {
+public:
+    explicit ConfigBus(tcs34725_config_t& config) : config_(config) {}
+
+    int8_t read(uint8_t command, uint8_t* data, uint32_t len) {
+        return config_.read_reg(command & 0x1F, data, len, config_.user_ptr);
+    }
+    int8_t write(uint8_t command, const uint8_t* data, uint32_t len) {
+        if (len == 0) {
+            return config_.write_byte(command, config_.user_ptr);
+        }
+        return config_.write_reg(command & 0x1F, data, len, config_.user_ptr);
+    }
+    void delay_ms(uint32_t period) {
+        config_.delay_ms(period);
+    }
+
+private:
+    tcs34725_config_t& config_;
+};
+
+
+template <class Bus, tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+class Sensor {
+public:
+    // Integration cycles of 2.4ms
+    static constexpr uint32_t cycles = 256 - static_cast<uint32_t>(IT);
+    // Delay for one integration, 2.4ms per cycle rounded up (50ms and 101ms really take 50.4ms and 103.2ms)
+    static constexpr uint32_t integration_delay_ms = (cycles * 24 + 9) / 10;
+    // Clear channel count at which samples are considered saturated (tcs34725_calculate_saturation)
+    static constexpr uint16_t saturation = (cycles > 63) ? 65535 :
+        static_cast<uint16_t>(1024 * cycles - (1024 * cycles) / 4);
+    static constexpr uint32_t gain_factor =
+        (Gain == TCS34725_GAIN_4X) ? 4 :
+        (Gain == TCS34725_GAIN_16X) ? 16 :
+        (Gain == TCS34725_GAIN_60X) ? 60 : 1;
+    // Converts counts to counts per 2.4ms cycle at 1x gain (comparable across settings)
+    static constexpr float count_scale = 1.0f / static_cast<float>(cycles * gain_factor);
+
+    explicit Sensor(Bus& bus) : bus_(bus) {}
+
+    // Check the ID, write the settings and start integrating (blocks for the first integration)
+    tcs34725_err_t init() {
+        uint8_t id = 0;
+        if (bus_.read(command(TCS34725_ID_REG), &id, 1) != 0) {
+            return TCS34725_ERR_READ;
+        }
+        if (id != TCS34725_ID && id != 0x10) {
+            return TCS34725_ERR_DEVICE_NOT_FOUND;
+        }
+        int err = 0;
+        err |= write8(TCS34725_ATIME_REG, static_cast<uint8_t>(IT));
+        err |= write8(TCS34725_CONTROL_REG, static_cast<uint8_t>(Gain));
+        return (err == 0) ? enable() : TCS34725_ERR_WRITE;
+    }
+
+    tcs34725_err_t enable() {
+        int err = 0;
+        err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON);
+        bus_.delay_ms(3);
+        err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+        bus_.delay_ms(integration_delay_ms);
+        return (err == 0) ? TCS34725_OK : TCS34725_ERR_WRITE;
+    }
+
+    tcs34725_err_t disable() {
+        return (write8(TCS34725_ENABLE_REG, 0) == 0) ? TCS34725_OK : TCS34725_ERR_WRITE;
+    }
+
+    // Status (optional) and all four channels in one burst read, no delay
+    tcs34725_err_t read(tcs34725_color_t& color, uint8_t* status = nullptr) {
+        uint8_t buf[9];
+        if (bus_.read(command(TCS34725_STATUS_REG), buf, sizeof(buf)) != 0) {
+            return TCS34725_ERR_READ;
+        }
+        if (status != nullptr) {
+            *status = buf[0];
+        }
+        color.clear = static_cast<uint16_t>(buf[1] | (buf[2] << 8));
+        color.red   = static_cast<uint16_t>(buf[3] | (buf[4] << 8));
+        color.green = static_cast<uint16_t>(buf[5] | (buf[6] << 8));
+        color.blue  = static_cast<uint16_t>(buf[7] | (buf[8] << 8));
+        return TCS34725_OK;
+    }
+
+    // Wait for the next integration and read it (same as tcs34725_get_raw_data)
+    tcs34725_err_t sample(tcs34725_color_t& color) {
+        bus_.delay_ms(integration_delay_ms);
+        return read(color);
+    }
+
+    tcs34725_err_t clear_interrupt() {
+        const uint8_t cmd = TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_SF_MODE, TCS34725_SF_INT_CLEAR);
+        return (bus_.write(cmd, nullptr, 0) == 0) ? TCS34725_OK : TCS34725_ERR_WRITE;
+    }
+
+    static bool saturated(const tcs34725_color_t& color) {
+        return color.clear >= saturation;
+    }
+
+    // Clear channel and lux in counts per cycle at 1x gain
+    static float normalized_clear(const tcs34725_color_t& color) {
+        return static_cast<float>(color.clear) * count_scale;
+    }
+
+    static float normalized_lux(const tcs34725_color_t& color) {
+        return static_cast<float>(tcs34725_calculate_lux(color)) * count_scale;
+    }
+
+    // Same as tcs34725_calculate_color_temperature_dn40 with the saturation threshold folded in
+    static uint16_t color_temperature_dn40(const tcs34725_color_t& color) {
+        return tcs34725_dn40(color, saturation);
+    }
+
+    static uint16_t lux(const tcs34725_color_t& color) {
+        return tcs34725_calculate_lux(color);
+    }
+
+private:
+    static constexpr uint8_t command(uint8_t reg) {
+        return TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_INCREMENT_ADDR, reg);
+    }
+
+    int8_t write8(uint8_t reg, uint8_t value) {
+        return bus_.write(command(reg), &value, 1);
+    }
+
+    Bus& bus_;
+};
+
+// Out of class definitions of the static members (required before C++17 when odr-used)
+template <class Bus, tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+constexpr uint32_t Sensor<Bus, IT, Gain>::cycles;
+template <class Bus, tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+constexpr uint32_t Sensor<Bus, IT, Gain>::integration_delay_ms;
+template <class Bus, tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+constexpr uint16_t Sensor<Bus, IT, Gain>::saturation;
+template <class Bus, tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+constexpr uint32_t Sensor<Bus, IT, Gain>::gain_factor;
+template <class Bus, tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+constexpr float Sensor<Bus, IT, Gain>::count_scale;
+
+} // namespace tcs34725
+
+#endif
@@ -0,0 +1,70 @@
+// Batch conversion kernels for offline processing of logged samples.
+//
+// Every function converts n samples at once, either from an array of
+// tcs34725_color_t (AoS) or from separate channel arrays (SoA). The loops
+// are written to auto-vectorize, explicit SSE2/AVX2/NEON paths are used
+// when the compiler targets them (define TCS34725_BATCH_NO_SIMD to disable).
+//
+// Results are bit-for-bit identical to the float build of the scalar
+// functions in tcs34725.h for in-range results, provided both are compiled
+// with the same floating point contraction setting (-ffp-contract=off is
+// recommended). Exceptions:
+//  - McCamy CCT: powf is replaced by multiplications, |error| <= 1K
+//  - Lux and CCT results outside 0-65535 saturate (undefined in the scalar versions)
+// The kernels always use float. With TCS34725_FIXED_POINT defined the scalar
+// lux and McCamy CCT take the integer paths instead and differ from the
+// kernels by the fixed point error bounds documented in tcs34725.c.
+// test/tcs34725_batch_test.c checks these claims.
+
+#ifndef TCS34725_BATCH_H
+#define TCS34725_BATCH_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include "tcs34725_defs.h"
+
+// Structure of arrays view of raw samples
+typedef struct {
+    const uint16_t* red;
+    const uint16_t* green;
+    const uint16_t* blue;
+    const uint16_t* clear;
+} tcs34725_color_soa_t;
+
+// CIE 1931 XYZ tristimulus values (Y = illuminance)
+typedef struct {
+    float X;
+    float Y;
+    float Z;
+} tcs34725_xyz_t;
+
+// Normalized RGB (same as tcs34725_get_normalized_RGB)
+void tcs34725_batch_normalized_RGB(const tcs34725_color_t*, size_t n, tcs34725_normalized_color_t*);
+void tcs34725_batch_normalized_RGB_soa(const tcs34725_color_soa_t*, size_t n, float* red, float* green, float* blue);
+
+// RGB to XYZ mapping (as used by tcs34725_calculate_color_temperature)
+void tcs34725_batch_xyz(const tcs34725_color_t*, size_t n, tcs34725_xyz_t*);
+void tcs34725_batch_xyz_soa(const tcs34725_color_soa_t*, size_t n, float* X, float* Y, float* Z);
+
+// Lux (same as tcs34725_calculate_lux)
+void tcs34725_batch_lux(const tcs34725_color_t*, size_t n, uint16_t* lux);
+void tcs34725_batch_lux_soa(const tcs34725_color_soa_t*, size_t n, uint16_t* lux);
+
+// Color temperature using McCamy's formula (same as tcs34725_calculate_color_temperature)
+void tcs34725_batch_color_temperature(const tcs34725_color_t*, size_t n, uint16_t* cct);
+void tcs34725_batch_color_temperature_soa(const tcs34725_color_soa_t*, size_t n, uint16_t* cct);
+
+// Color temperature using the DN40 method (same as tcs34725_calculate_color_temperature_dn40)
+void tcs34725_batch_color_temperature_dn40(const tcs34725_color_t*, size_t n, tcs34725_integration_time_t, uint16_t* cct);
+void tcs34725_batch_color_temperature_dn40_soa(const tcs34725_color_soa_t*, size_t n, tcs34725_integration_time_t, uint16_t* cct);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
@@ -0,0 +1,100 @@
+// Binary capture format for raw samples.
+//
+// File layout (all fields little endian):
+//   file header  : magic "TCS1", version, device ID, gain, ATIME, CRC-32 of the preceding 8 bytes
+//   blocks       : block header followed by the encoded samples
+//   block header : magic "BLK1", payload length (u16), sample count (u16),
+//                  first and last timestamp (u32 each), CRC-32 of the header fields and payload
+//   payload      : per sample the timestamp delta (varint), the status byte and the
+//                  C, R, G, B deltas (zigzag varints), each block starts from zero
+//
+// Every block decodes on its own and carries its time range in the header,
+// so a reader can seek by hopping from block header to block header, and a
+// damaged or truncated block is skipped by searching for the next block
+// magic. A sample takes 6-18 bytes, typically 6-8 for slowly changing light.
+//
+// The writer encodes into a caller-provided buffer without allocating.
+// Flush it, write buffer[0..length) to the file and call
+// tcs34725_capture_writer_restart to continue the stream in the same buffer.
+
+#ifndef TCS34725_CAPTURE_H
+#define TCS34725_CAPTURE_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+#define TCS34725_CAPTURE_VERSION      (1)
+#define TCS34725_CAPTURE_HEADER_SIZE  (12)
+#define TCS34725_CAPTURE_BLOCK_HEADER (20)
+// A block is closed once its payload reaches this size (bounds the data lost to a damaged block)
+#ifndef TCS34725_CAPTURE_BLOCK_PAYLOAD
+#define TCS34725_CAPTURE_BLOCK_PAYLOAD (1024)
+#endif
+
+// Writer state
+typedef struct {
+    uint8_t*          buffer;        // Output buffer
+    size_t            capacity;      // Size of buffer
+    size_t            length;        // Bytes of buffer in use
+    size_t            block;         // Offset of the open block header (valid when count > 0)
+    uint16_t          count;         // Samples in the open block
+    tcs34725_sample_t last;          // Previous sample of the open block
+    uint32_t          first_time;    // Timestamp of the first sample of the open block
+} tcs34725_capture_writer_t;
+
+// Start a capture, writes the file header
+tcs34725_err_t tcs34725_capture_writer_init(tcs34725_capture_writer_t*, uint8_t* buffer, size_t capacity, tcs34725_settings_t, uint8_t id);
+// Append a sample (TCS34725_ERR_WRITE when the buffer is full, flush and restart first)
+tcs34725_err_t tcs34725_capture_append(tcs34725_capture_writer_t*, const tcs34725_sample_t*);
+// Close the open block, buffer[0..length) is then a complete part of the file
+void tcs34725_capture_flush(tcs34725_capture_writer_t*);
+// Reuse the buffer for the next part of the file (call after flush, the file header is not repeated)
+void tcs34725_capture_writer_restart(tcs34725_capture_writer_t*);
+
+// Capture being read
+typedef struct {
+    const uint8_t*      data;       // File contents
+    size_t              size;       // File size
+    tcs34725_settings_t settings;   // Settings from the file header
+    uint8_t             id;         // Device ID from the file header
+    int                 fd;         // File descriptor (tcs34725_capture_open only)
+} tcs34725_capture_reader_t;
+
+// Position in a capture
+typedef struct {
+    const tcs34725_capture_reader_t* reader;
+    size_t            block;        // Offset of the current block header
+    size_t            pos;          // Offset of the next encoded sample
+    size_t            end;          // End of the current block payload
+    uint16_t          remaining;    // Samples left in the current block
+    tcs34725_sample_t last;         // Previously decoded sample
+    uint32_t          bad_blocks;   // Damaged stretches skipped, adjacent damaged blocks count once (statistics)
+} tcs34725_capture_iter_t;
+
+// Read a capture held in memory
+tcs34725_err_t tcs34725_capture_reader_init(tcs34725_capture_reader_t*, const uint8_t* data, size_t size);
+// Memory map a capture file (Linux), close unmaps it
+tcs34725_err_t tcs34725_capture_open(tcs34725_capture_reader_t*, const char* path);
+void tcs34725_capture_close(tcs34725_capture_reader_t*);
+
+// Iterate over the samples from the start of the capture
+void tcs34725_capture_begin(const tcs34725_capture_reader_t*, tcs34725_capture_iter_t*);
+bool tcs34725_capture_next(tcs34725_capture_iter_t*, tcs34725_sample_t*);
+// Position the iterator at the first sample with a timestamp >= time (only the block headers are read on the way)
+void tcs34725_capture_seek(const tcs34725_capture_reader_t*, tcs34725_capture_iter_t*, uint32_t time);
+
+// CRC-32 (IEEE 802.3) used by the format
+uint32_t tcs34725_capture_crc32(uint32_t crc, const uint8_t* data, size_t len);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
@@ -0,0 +1,72 @@
+// Nearest reference color classification.
+//
+// Samples are compared in rg chromaticity space (r = R / (R + G + B),
+// g = G / (R + G + B)), which does not depend on the brightness. The
+// palette is compiled once into a TCS34725_CLASSIFY_GRID x
+// TCS34725_CLASSIFY_GRID grid over that space; every cell lists only the
+// references that can be the nearest or second nearest for some point in
+// the cell, so a lookup compares against a handful of candidates
+// regardless of the palette size and the result is the same as a linear
+// search.
+//
+// All storage is provided by the caller (no heap): a chromaticity array
+// with one entry per reference and the candidate lists.
+
+#ifndef TCS34725_CLASSIFY_H
+#define TCS34725_CLASSIFY_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+// Grid cells per axis
+#ifndef TCS34725_CLASSIFY_GRID
+#define TCS34725_CLASSIFY_GRID (16)
+#endif
+// Index reported for rejected samples
+#define TCS34725_CLASSIFY_REJECT (0xFFFF)
+
+// rg chromaticity
+typedef struct {
+    float r;
+    float g;
+} tcs34725_chromaticity_t;
+
+// Classification result
+typedef struct {
+    uint16_t index;       // Palette index of the nearest reference (TCS34725_CLASSIFY_REJECT if too far)
+    float    distance;    // Chromaticity distance to the nearest reference
+    float    confidence;  // 1 - distance / second nearest distance (0 = ambiguous, 1 = exact match)
+} tcs34725_classification_t;
+
+// Classifier
+typedef struct {
+    const tcs34725_chromaticity_t* points;      // Reference chromaticities
+    uint16_t                       count;       // Number of references
+    float                          reject;      // Samples further than this from every reference are rejected (0 = never)
+    uint16_t*                      candidates;  // Candidate lists of all cells
+    uint16_t cells[TCS34725_CLASSIFY_GRID * TCS34725_CLASSIFY_GRID + 1];  // Start of each cell's candidate list
+} tcs34725_classifier_t;
+
+// Chromaticity of a normalized color
+tcs34725_chromaticity_t tcs34725_chromaticity(tcs34725_normalized_color_t);
+
+// Build the index. points receives the chromaticity of each palette entry, candidates holds up to
+// capacity entries (65535 max); used reports the number needed (TCS34725_ERR_INVALID_ARG if larger than capacity)
+tcs34725_err_t tcs34725_classify_init(tcs34725_classifier_t*, const tcs34725_normalized_color_t* palette, uint16_t count,
+                                      tcs34725_chromaticity_t* points, uint16_t* candidates, size_t capacity, size_t* used, float reject);
+
+tcs34725_classification_t tcs34725_classify(const tcs34725_classifier_t*, tcs34725_normalized_color_t);
+void tcs34725_classify_batch(const tcs34725_classifier_t*, const tcs34725_normalized_color_t*, size_t n, tcs34725_classification_t*);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
@@ -4,6 +4,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
 
 //Device Bus Address
 #define TCS34725_ADDRESS        (0x29)        // I2C address
@@ -113,6 +114,21 @@ typedef enum {
     TCS34725_GAIN_60X = 0x03  // 60x gain
 } tcs34725_gain_t;
 
+// Automatic gain control settings
+typedef struct {
+    uint16_t min_counts;          // Clear channel count required for the desired resolution
+    uint8_t  hysteresis;          // Margin in percent (0-99) applied to min_counts and saturation before retuning
+    uint16_t max_integration_ms;  // Latency budget, longest integration time that may be selected (0 = no limit)
+} tcs34725_agc_t;
+
+// Event mode settings (the AILT/AIHT window is centered on the last clear channel value)
+typedef struct {
+    uint16_t hysteresis;          // Minimum half width of the window in clear channel counts
+    uint8_t  hysteresis_percent;  // Half width in percent of the last clear value (the larger of the two is used)
+    uint8_t  persistence;         // Consecutive samples outside the window before AINT (TCS34725_PERS_1_CYCLE or higher)
+    uint32_t period_ms;           // Sample period using the wait timer (0 = back to back integrations)
+} tcs34725_event_t;
+
 // Error codes for TCS34725
 typedef enum {
     TCS34725_OK,
@@ -120,13 +136,30 @@ typedef enum {
     TCS34725_ERR_DEVICE_NOT_FOUND,
     TCS34725_ERR_WRITE,
     TCS34725_ERR_READ,
+    TCS34725_ERR_NOT_READY,
+    TCS34725_ERR_INVALID_ARG,
 } tcs34725_err_t;
 
+// Non-blocking acquisition state
+typedef enum {
+    TCS34725_STATE_IDLE,         // Not started (or stopped by tcs34725_disable)
+    TCS34725_STATE_POWER_ON,     // PON written, waiting for the oscillator to settle
+    TCS34725_STATE_INTEGRATING,  // AEN written, waiting for an integration cycle to complete
+    TCS34725_STATE_READY,        // Sample available through tcs34725_fetch
+    TCS34725_STATE_CONTINUOUS,   // Device runs autonomously using the wait timer
+    TCS34725_STATE_EVENT,        // Device runs autonomously, interrupts only when the clear channel leaves the window
+} tcs34725_acquisition_state_t;
+
 // Define platform specific function pointers (return 0 for success, return non-zero for error)
+// reg_addr is a bare register address, the platform builds the command byte around it. Transfers of
+// more than one byte (burst reads of the color data) rely on the auto-increment protocol, e.g.
+// TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_INCREMENT_ADDR, reg_addr). single_byte is a
+// complete command byte (special functions)
 typedef int8_t (*tcs34725_read_reg_fptr_t)(uint8_t reg_addr, uint8_t *reg_data, uint32_t len, void* user_ptr);
 typedef int8_t (*tcs34725_write_reg_fptr_t)(uint8_t reg_addr, const uint8_t *reg_data, uint32_t len, void* user_ptr);
 typedef int8_t (*tcs34725_write_byte_fptr_t)(uint8_t single_byte, void* user_ptr);
 typedef void   (*tcs34725_delay_ms_fptr_t)(uint32_t period);
+typedef uint32_t (*tcs34725_get_tick_ms_fptr_t)(void);  // Monotonic millisecond tick, wrap around is allowed
 
 // Color type
 typedef struct {
@@ -143,12 +176,88 @@ typedef struct {
     float blue;
 } tcs34725_normalized_color_t;
 
+// Normalized color type (fixed point with TCS34725_FIXED_FRAC_BITS fractional bits, 0-255 when channel <= clear)
+#define TCS34725_FIXED_FRAC_BITS (8)
+typedef struct {
+    uint32_t red;
+    uint32_t green;
+    uint32_t blue;
+} tcs34725_normalized_color_fixed_t;
+
 // Device settings
 typedef struct {
     tcs34725_gain_t gain;
     tcs34725_integration_time_t integration_time;
 } tcs34725_settings_t;
 
+// Timestamped sample
+typedef struct {
+    tcs34725_color_t color;
+    uint32_t         timestamp;  // get_tick_ms() when the sample was read (0 without a tick source)
+    uint8_t          status;     // STATUS register read together with the sample
+} tcs34725_sample_t;
+
+// Fixed capacity sample ring buffer (storage provided by the user, no allocation)
+typedef struct {
+    tcs34725_sample_t* samples;   // Sample storage
+    uint16_t           capacity;  // Number of elements in samples
+    uint16_t           head;      // Index of the oldest sample
+    uint16_t           count;     // Number of samples stored
+    uint32_t           overruns;  // Number of samples dropped because the buffer was full
+} tcs34725_ring_buffer_t;
+
+// Driver state (managed by the driver, zero initialize)
+typedef struct {
+    tcs34725_acquisition_state_t acquisition;  // Non-blocking acquisition state
+    uint32_t                     timestamp;    // Tick of the last acquisition state change
+    tcs34725_color_t             sample;       // Sample captured by tcs34725_poll
+    uint32_t                     period_ms;    // Continuous mode sample period
+    uint8_t                      shadow[TCS34725_CONTROL_REG + 1];  // Copy of the writable registers
+    uint16_t                     shadow_valid; // Bit n set when shadow[n] matches the device
+} tcs34725_state_t;
+
+/* Instrumentation (only updated when the driver is built with TCS34725_INSTRUMENTATION).
+   The types and the config pointer exist in every build so that the
+   layout of tcs34725_config_t does not depend on the flag, a library and
+   an application built with different settings stay compatible */
+
+// Driver statistics (zero initialize, or clear at any time)
+typedef struct {
+    uint32_t transactions;   // Bus transactions attempted (including retries)
+    uint32_t bytes_read;     // Register bytes read
+    uint32_t bytes_written;  // Register bytes written
+    uint32_t retries;        // Bus operations repeated (TCS34725_BUS_RETRIES)
+    uint32_t read_errors;    // Reads that failed after all retries
+    uint32_t write_errors;   // Writes that failed after all retries
+    uint32_t saturated;      // Samples read at or above the saturation threshold
+    uint32_t avalid_misses;  // Status reads that found no valid sample yet
+    uint32_t sleep_ms;       // Total time requested from delay_ms
+} tcs34725_stats_t;
+
+// Traced operations
+typedef enum {
+    TCS34725_TRACE_BUS_READ,   // read_reg call
+    TCS34725_TRACE_BUS_WRITE,  // write_reg/write_byte call
+    TCS34725_TRACE_DELAY,      // delay_ms call
+    TCS34725_TRACE_SAMPLE,     // Data (and status) read of a sample
+    TCS34725_TRACE_INIT,       // tcs34725_init
+    TCS34725_TRACE_ONE_SHOT,   // tcs34725_one_shot
+} tcs34725_trace_event_t;
+
+// Trace callback, called at the beginning and end of each operation (timestamp in microseconds, see below)
+typedef void (*tcs34725_trace_fptr_t)(tcs34725_trace_event_t event, bool begin, uint32_t timestamp_us, void* user_ptr);
+
+// Monotonic microsecond tick for trace timestamps, wrap around is allowed
+typedef uint32_t (*tcs34725_get_tick_us_fptr_t)(void);
+
+// Statistics and trace hooks (attached to the config by pointer)
+typedef struct {
+    tcs34725_stats_t            stats;           // Statistics
+    tcs34725_trace_fptr_t       trace;           // Trace callback (optional)
+    void*                       trace_user_ptr;  // User pointer for trace
+    tcs34725_get_tick_us_fptr_t get_tick_us;     // Trace timestamps (optional, get_tick_ms * 1000 otherwise, 0 without either)
+} tcs34725_instrumentation_t;
+
 // Device configuration
 typedef struct {
     void*                      user_ptr;    // User pointer for arbitrary use
@@ -157,6 +266,10 @@ typedef struct {
     tcs34725_write_byte_fptr_t write_byte;  // Write a single byte function pointer
     tcs34725_delay_ms_fptr_t   delay_ms;    // Delay function pointer
     tcs34725_settings_t        settings;    // Sensor settings
+    tcs34725_get_tick_ms_fptr_t get_tick_ms; // Tick function pointer (optional, required by the non-blocking API)
+    tcs34725_ring_buffer_t*    ring;        // Continuous mode sample buffer (optional, required by continuous mode)
+    tcs34725_state_t           state;       // Driver state
+    tcs34725_instrumentation_t* instrumentation; // Statistics and trace hooks (optional, needs TCS34725_INSTRUMENTATION)
 } tcs34725_config_t;
 
 
@@ -0,0 +1,64 @@
+// Ripple rejecting decimation filter.
+//
+// Integration times under 50ms pick up the 100/120Hz ripple of mains
+// powered light sources. A boxcar over 50ms (5 ripple periods at 50Hz, 6
+// at 60Hz) cancels it, so this filter keeps a moving sum over the samples
+// of the last window_ms and outputs the average every decimation samples:
+// with 2.4ms integrations and decimation 4 that is a ripple free value
+// every ~10ms. An optional single pole IIR (alpha = 2^-iir_shift) smooths
+// the decimated output further.
+//
+// Samples at or above the saturation threshold of the integration time are
+// rejected. Samples are assumed to arrive back to back (one per integration
+// period), so a rejected sample also empties the window (and the IIR state)
+// like tcs34725_filter_reset: otherwise the boxcar would average over a
+// longer span with a gap and no longer cancel the ripple. Output resumes
+// once the window is full again. Storage is fixed
+// (TCS34725_FILTER_MAX_TAPS samples) and the cost per sample is constant.
+
+#ifndef TCS34725_FILTER_H
+#define TCS34725_FILTER_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+// Maximum window length in samples (50ms at 2.4ms needs 21)
+#ifndef TCS34725_FILTER_MAX_TAPS
+#define TCS34725_FILTER_MAX_TAPS (32)
+#endif
+
+// Filter state
+typedef struct {
+    tcs34725_color_t taps[TCS34725_FILTER_MAX_TAPS];  // Samples in the window
+    uint32_t         sum[4];       // Moving sum of the window (R, G, B, C)
+    uint32_t         iir[4];       // IIR state with 8 fractional bits (R, G, B, C)
+    uint16_t         saturation;   // Samples with clear >= saturation are rejected
+    uint8_t          length;       // Window length in samples
+    uint8_t          count;        // Samples in the window (output starts once it is full)
+    uint8_t          index;        // Next tap to overwrite
+    uint8_t          decimation;   // Output every decimation accepted samples
+    uint8_t          phase;        // Accepted samples since the last output
+    uint8_t          iir_shift;    // IIR coefficient 2^-iir_shift (0 = no IIR)
+    bool             iir_valid;    // IIR state initialized
+    uint32_t         rejected;     // Number of saturated samples rejected, each one resets the window (statistics)
+} tcs34725_filter_t;
+
+// Set up a filter for an integration time, window_ms is rounded to whole samples (up to TCS34725_FILTER_MAX_TAPS)
+tcs34725_err_t tcs34725_filter_init(tcs34725_filter_t*, tcs34725_integration_time_t, uint16_t window_ms, uint8_t decimation, uint8_t iir_shift);
+// Empty the window (after changing the gain or when samples were lost)
+void tcs34725_filter_reset(tcs34725_filter_t*);
+// Add a sample, returns true when a filtered value was written to out
+bool tcs34725_filter_push(tcs34725_filter_t*, tcs34725_color_t sample, tcs34725_color_t* out);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
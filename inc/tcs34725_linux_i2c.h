@@ -0,0 +1,86 @@
+// Linux userspace platform backend (/dev/i2c-N).
+//
+// Register reads are issued as one I2C_RDWR ioctl holding the command byte
+// write and the data read (combined transaction with a repeated start), so
+// every driver bus transaction costs exactly one syscall. Between
+// tcs34725_linux_i2c_begin() and tcs34725_linux_i2c_end() register writes
+// are queued instead, and sent together with the next read, the next delay
+// (so that timing between writes, e.g. the PON warm-up, is kept) or by
+// end() in a single ioctl. Only one device can batch at a time since
+// delay_ms has no user pointer.
+//
+// A queued write that fails to go out is reported by the call that sent it
+// (read, write or end), or by the next call if it was sent by delay_ms.
+// The register shadow of the attached config is invalidated in that case,
+// as the device contents are unknown.
+//
+// Adapters without plain I2C support (e.g. the i2c-stub module) are driven
+// with SMBus I2C block transfers instead, one syscall per operation and
+// without batching.
+//
+// The ioctl function can be replaced to run against a local fake.
+
+#ifndef TCS34725_LINUX_I2C_H
+#define TCS34725_LINUX_I2C_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include <linux/i2c.h>
+#include "tcs34725_defs.h"
+
+// Maximum number of messages sent in one I2C_RDWR ioctl (kernel limit is I2C_RDWR_IOCTL_MAX_MSGS)
+#ifndef TCS34725_LINUX_I2C_MAX_MSGS
+#define TCS34725_LINUX_I2C_MAX_MSGS (16)
+#endif
+// Size of the buffer holding queued write messages (command byte + data)
+#ifndef TCS34725_LINUX_I2C_TX_SIZE
+#define TCS34725_LINUX_I2C_TX_SIZE  (64)
+#endif
+
+// ioctl(2) replacement
+typedef int (*tcs34725_ioctl_fptr_t)(int fd, unsigned long request, void* arg);
+
+// Backend state (user_ptr of the config)
+typedef struct {
+    int                   fd;                                   // /dev/i2c-N file descriptor
+    uint16_t              address;                              // 7-bit device address
+    tcs34725_ioctl_fptr_t ioctl_fn;                             // ioctl implementation (NULL = ioctl(2))
+    bool                  smbus;                                // Adapter only supports SMBus transfers
+    bool                  batching;                             // Writes are queued (between begin and end)
+    struct i2c_msg        msgs[TCS34725_LINUX_I2C_MAX_MSGS];    // Queued messages
+    uint32_t              msg_count;                            // Number of queued messages
+    uint8_t               tx[TCS34725_LINUX_I2C_TX_SIZE];       // Storage for queued write messages
+    uint32_t              tx_used;                              // Bytes of tx in use
+    bool                  write_error;                          // Queued writes sent by delay_ms failed (reported by the next call)
+    tcs34725_config_t*    config;                               // Attached config (shadow invalidated on failed queued writes)
+    uint32_t              syscalls;                             // Number of ioctls issued (statistics)
+} tcs34725_linux_i2c_t;
+
+// Open /dev/i2c-N and probe the adapter functionality (ioctl_fn may be set before the call)
+tcs34725_err_t tcs34725_linux_i2c_open(tcs34725_linux_i2c_t*, const char* path, uint16_t address);
+void tcs34725_linux_i2c_close(tcs34725_linux_i2c_t*);
+// Point the platform functions of a config at the backend
+void tcs34725_linux_i2c_attach(tcs34725_linux_i2c_t*, tcs34725_config_t*);
+
+// Queue register writes until the next read, delay or tcs34725_linux_i2c_end
+void tcs34725_linux_i2c_begin(tcs34725_linux_i2c_t*);
+int8_t tcs34725_linux_i2c_end(tcs34725_linux_i2c_t*);
+
+// Platform functions (user_ptr is the tcs34725_linux_i2c_t)
+int8_t tcs34725_linux_i2c_read_reg(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr);
+int8_t tcs34725_linux_i2c_write_reg(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr);
+int8_t tcs34725_linux_i2c_write_byte(uint8_t single_byte, void* user_ptr);
+void tcs34725_linux_i2c_delay_ms(uint32_t period);
+uint32_t tcs34725_linux_i2c_get_tick_ms(void);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
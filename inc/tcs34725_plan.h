@@ -0,0 +1,61 @@
+// Per-configuration conversion plans.
+//
+// A plan is built once for a gain/integration time setting and holds
+// everything the conversions need that does not depend on the sample:
+// the saturation threshold, the XYZ/McCamy rows with an optional
+// per-device calibration matrix folded in, and a lookup table of McCamy's
+// cubic. A conversion is then three dot products, one division
+// and a table lookup with linear interpolation.
+//
+// The table storage is provided by the caller (no allocation), its size
+// trades flash for accuracy: compared to the cubic the interpolation adds
+// up to 14K with 16 entries, 3K with 32 and 1K (rounding) from 64 entries
+// on. McCamy values outside the table range, or plans without a table,
+// use the cubic. Without a calibration matrix the folded rows give the
+// result of tcs34725_calculate_color_temperature within 1K (rounding) over
+// the table range. test/tcs34725_plan_test.c checks these bounds.
+
+#ifndef TCS34725_PLAN_H
+#define TCS34725_PLAN_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+// Range of McCamy's n covered by the lookup table (about 2300K to 17000K)
+#define TCS34725_PLAN_N_MIN (-0.6F)
+#define TCS34725_PLAN_N_MAX (1.05F)
+
+// Conversion plan
+typedef struct {
+    tcs34725_settings_t settings;     // Settings the plan was built for
+    uint16_t            saturation;   // Clear channel saturation threshold (tcs34725_calculate_saturation)
+    float               lux[3];       // Illuminance row (R, G, B)
+    float               num[3];       // McCamy numerator row, X - 0.3320 (X + Y + Z)
+    float               den[3];       // McCamy denominator row, 0.1858 (X + Y + Z) - Y
+    uint16_t*           cct_table;    // CCT at evenly spaced n over the table range (optional)
+    uint16_t            cct_size;     // Number of entries in cct_table
+    float               n_scale;      // Table entries per unit of n
+} tcs34725_plan_t;
+
+// Build a plan. calibration is a row-major 3x3 matrix applied to the raw RGB values (NULL = none),
+// table provides table_size entries of storage for the CCT lookup table (NULL/0 = evaluate the cubic)
+tcs34725_err_t tcs34725_plan_init(tcs34725_plan_t*, tcs34725_settings_t, const float* calibration, uint16_t* table, uint16_t table_size);
+
+// Conversions (results saturate to 0-65535). DN40 uses the raw counts, its coefficients do not apply to calibrated values
+uint16_t tcs34725_plan_color_temperature(const tcs34725_plan_t*, tcs34725_color_t);
+uint16_t tcs34725_plan_color_temperature_dn40(const tcs34725_plan_t*, tcs34725_color_t);
+uint16_t tcs34725_plan_lux(const tcs34725_plan_t*, tcs34725_color_t);
+bool tcs34725_plan_saturated(const tcs34725_plan_t*, tcs34725_color_t);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
@@ -0,0 +1,71 @@
+// Lock-free publication of the latest sample.
+//
+// One producer thread owns the tcs34725_config_t and is the only code that
+// touches the bus. Each sample, together with the derived lux and color
+// temperature and its timestamp, is published through a sequence lock:
+// readers copy four words and check the sequence counter, retrying only
+// if a write happened during the copy. Readers never block the producer,
+// never take a lock and never access the bus, so the read cost is a few
+// loads regardless of the integration time.
+//
+// Requires C11 atomics (<stdatomic.h>), so this header is C only. The
+// publisher layout depends on the C atomic types and cannot be shared with
+// C++ code through an extern "C" block.
+
+#ifndef TCS34725_PUBLISH_H
+#define TCS34725_PUBLISH_H
+
+
+#include <stdbool.h>
+#include <stdatomic.h>
+#include "tcs34725_defs.h"
+
+// Published sample
+typedef struct {
+    tcs34725_color_t color;
+    uint16_t         lux;                // tcs34725_calculate_lux
+    uint16_t         color_temperature;  // tcs34725_calculate_color_temperature_dn40
+    uint32_t         timestamp;          // get_tick_ms() when the sample was read
+    uint32_t         sequence;           // Number of samples published so far (changes with every new sample)
+} tcs34725_snapshot_t;
+
+// Sequence lock (zero initialize)
+typedef struct {
+    atomic_uint_least32_t seq;       // Odd while a write is in progress
+    atomic_uint_least32_t words[4];  // Packed sample (see tcs34725_publish)
+} tcs34725_publisher_t;
+
+// Publish a sample (single producer, the sequence field is ignored)
+void tcs34725_publish(tcs34725_publisher_t*, const tcs34725_snapshot_t*);
+// Acquire one sample with the non-blocking API (sleeping with delay_ms) and publish it.
+// Returns TCS34725_ERR_INVALID_ARG if the device is in continuous or event mode
+tcs34725_err_t tcs34725_publish_step(tcs34725_publisher_t*, tcs34725_config_t*);
+// Producer thread body, runs tcs34725_publish_step until stop is set (the device is disabled on return)
+tcs34725_err_t tcs34725_publish_run(tcs34725_publisher_t*, const atomic_bool* stop, tcs34725_config_t*);
+
+// Take a consistent snapshot of the latest sample (any thread, returns false until the first sample)
+static inline bool tcs34725_publish_read(tcs34725_publisher_t* pub, tcs34725_snapshot_t* snapshot) {
+    uint_least32_t begin, end;
+    uint_least32_t words[4];
+    do {
+        begin = atomic_load_explicit(&pub->seq, memory_order_acquire);
+        for(int i = 0; i < 4; i++){
+            words[i] = atomic_load_explicit(&pub->words[i], memory_order_relaxed);
+        }
+        atomic_thread_fence(memory_order_acquire);
+        end = atomic_load_explicit(&pub->seq, memory_order_relaxed);
+    } while((begin & 1) || begin != end);
+
+    snapshot->color.red         = (uint16_t)(words[0] & 0xFFFF);
+    snapshot->color.green       = (uint16_t)(words[0] >> 16);
+    snapshot->color.blue        = (uint16_t)(words[1] & 0xFFFF);
+    snapshot->color.clear       = (uint16_t)(words[1] >> 16);
+    snapshot->lux               = (uint16_t)(words[2] & 0xFFFF);
+    snapshot->color_temperature = (uint16_t)(words[2] >> 16);
+    snapshot->timestamp         = (uint32_t)words[3];
+    snapshot->sequence          = (uint32_t)(begin >> 1);
+    return begin != 0;
+}
+
+
+#endif
@@ -0,0 +1,67 @@
+// Multi-sensor scheduler.
+//
+// All TCS34725 devices share the fixed address TCS34725_ADDRESS, so several
+// sensors on one bus sit behind an I2C mux. The scheduler drives a set of
+// configs with the non-blocking API (tcs34725_start/poll/fetch) so that
+// the integrations of all sensors overlap instead of running one after
+// the other. Sensors are serviced in (bus, mux channel) order, which is also
+// the order their integrations complete in, so the mux is only switched
+// when a sensor actually needs the bus.
+//
+// Every config needs get_tick_ms, they should share the same time base.
+
+#ifndef TCS34725_SCHED_H
+#define TCS34725_SCHED_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+// Select a mux channel (return 0 for success, return non-zero for error)
+typedef int8_t (*tcs34725_mux_select_fptr_t)(uint8_t channel, void* user_ptr);
+
+// Bus shared by several sensors
+typedef struct {
+    tcs34725_mux_select_fptr_t select;   // Mux channel select (NULL if the bus has no mux)
+    void*                      user_ptr; // User pointer passed to select
+    int16_t                    channel;  // Currently selected channel (-1 = unknown, managed by the scheduler)
+} tcs34725_bus_t;
+
+// Sensor managed by the scheduler
+typedef struct {
+    tcs34725_config_t* config;   // Driver configuration (initialized with tcs34725_init)
+    uint8_t            bus;      // Index into the scheduler's buses
+    uint8_t            channel;  // Mux channel
+    tcs34725_color_t   color;    // Result of the last batch
+    tcs34725_err_t     err;      // Error of the last batch
+    bool               pending;  // Waiting for a sample (managed by the scheduler)
+} tcs34725_sched_sensor_t;
+
+// Scheduler
+typedef struct {
+    tcs34725_bus_t*          buses;         // Buses
+    size_t                   bus_count;     // Number of buses
+    tcs34725_sched_sensor_t* sensors;       // Sensors
+    size_t                   sensor_count;  // Number of sensors
+    uint16_t*                order;         // Storage for sensor_count indices (service order)
+    tcs34725_delay_ms_fptr_t delay_ms;      // Used while no sensor has bus work to do
+    bool                     free_running;  // Keep sensors integrating between batches (otherwise power down)
+    uint32_t                 mux_switches;  // Number of mux channel changes (statistics)
+} tcs34725_sched_t;
+
+// Validate the sensor list and compute the service order
+tcs34725_err_t tcs34725_sched_init(tcs34725_sched_t*);
+// Acquire one sample from every sensor, results are stored in sensors[i].color and sensors[i].err
+tcs34725_err_t tcs34725_sched_run(tcs34725_sched_t*);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
@@ -0,0 +1,122 @@
+// Precompiled bus transaction scripts.
+//
+// A script is a short list of bus steps (register write, register read,
+// special function command, delay) built once into static storage and then
+// handed as a whole to a backend, e.g. one that runs it with DMA and calls
+// back when done, instead of going through one read_reg/write_reg call per
+// transaction.
+//
+// Reads scatter directly into their destinations. The data registers are
+// little endian in the order C, R, G, B, which matches the in-memory layout
+// of tcs34725_color_t (red, green, blue after clear) on little endian hosts,
+// so a sample read is two segments (CDATA -> clear, RGB -> red..blue) with
+// no intermediate buffer. Backends on big endian hosts swap the color
+// segments after the transfer (the host reference implementation does).
+//
+// tcs34725_script_execute is a reference backend on top of the
+// synchronous platform functions of a config.
+
+#ifndef TCS34725_SCRIPT_H
+#define TCS34725_SCRIPT_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+#ifndef TCS34725_SCRIPT_MAX_STEPS
+#define TCS34725_SCRIPT_MAX_STEPS    (8)
+#endif
+#ifndef TCS34725_SCRIPT_MAX_SEGMENTS
+#define TCS34725_SCRIPT_MAX_SEGMENTS (8)
+#endif
+#ifndef TCS34725_SCRIPT_MAX_DATA
+#define TCS34725_SCRIPT_MAX_DATA     (16)
+#endif
+
+// Step type
+typedef enum {
+    TCS34725_STEP_WRITE,     // Write data[0..len) starting at the command byte
+    TCS34725_STEP_COMMAND,   // Command byte only (special functions, e.g. interrupt clear)
+    TCS34725_STEP_READ,      // Read segments in order starting at the command byte
+    TCS34725_STEP_DELAY,     // Wait delay_ms
+} tcs34725_step_type_t;
+
+// What a read segment holds (used to retarget scripts and for byte order fixes)
+typedef enum {
+    TCS34725_SEGMENT_RAW,     // Plain bytes
+    TCS34725_SEGMENT_STATUS,  // STATUS register (1 byte)
+    TCS34725_SEGMENT_CLEAR,   // CDATAL..CDATAH into color.clear (2 bytes)
+    TCS34725_SEGMENT_RGB,     // RDATAL..BDATAH into color.red, green, blue (6 bytes)
+} tcs34725_segment_kind_t;
+
+// Read destination
+typedef struct {
+    uint8_t*                dest;
+    uint8_t                 len;
+    tcs34725_segment_kind_t kind;
+} tcs34725_segment_t;
+
+// Bus step
+typedef struct {
+    tcs34725_step_type_t type;
+    uint8_t              command;        // Command byte (WRITE, COMMAND, READ)
+    uint8_t              first;          // First data byte (WRITE) or segment (READ)
+    uint8_t              count;          // Number of data bytes (WRITE) or segments (READ)
+    uint16_t             delay_ms;       // DELAY
+} tcs34725_step_t;
+
+// Script storage (static or on the stack, no allocation)
+typedef struct {
+    tcs34725_step_t    steps[TCS34725_SCRIPT_MAX_STEPS];
+    tcs34725_segment_t segments[TCS34725_SCRIPT_MAX_SEGMENTS];
+    uint8_t            data[TCS34725_SCRIPT_MAX_DATA];      // Write payloads
+    uint8_t            step_count;
+    uint8_t            segment_count;
+    uint8_t            data_count;
+} tcs34725_script_t;
+
+// Completion callback (result 0 for success, non-zero for error)
+typedef void (*tcs34725_script_done_fptr_t)(int8_t result, void* done_ptr);
+// Backend: start running a script and call done when it has finished (may be called before returning).
+// Scripts write registers behind the driver, so before done is called the backend must either update the
+// register shadow and settings of the config it runs for (as tcs34725_script_execute does) or call
+// tcs34725_invalidate_cache, otherwise later tcs34725_set_* calls may be dropped as redundant
+typedef int8_t (*tcs34725_script_submit_fptr_t)(const tcs34725_script_t*, tcs34725_script_done_fptr_t done, void* done_ptr, void* user_ptr);
+
+// Building blocks (return TCS34725_ERR_INVALID_ARG when the storage is full)
+void tcs34725_script_reset(tcs34725_script_t*);
+tcs34725_err_t tcs34725_script_write(tcs34725_script_t*, uint8_t reg, const uint8_t* data, uint8_t len);
+tcs34725_err_t tcs34725_script_clear_interrupt(tcs34725_script_t*);
+tcs34725_err_t tcs34725_script_read(tcs34725_script_t*, uint8_t reg, const tcs34725_segment_t* segments, uint8_t count);
+tcs34725_err_t tcs34725_script_delay(tcs34725_script_t*, uint16_t delay_ms);
+
+// Common sequences (appended to the script)
+// Status (optional) and all channels in one read
+tcs34725_err_t tcs34725_script_fetch(tcs34725_script_t*, tcs34725_color_t*, uint8_t* status);
+// Power on, integrate once, read and power down. interrupt keeps AIEN set in every ENABLE write (as
+// tcs34725_one_shot keeps the bit configured by tcs34725_set_interrupt). There is no AVALID polling,
+// the fixed delay has a 10% margin over the nominal integration time, check AVALID in the status byte
+tcs34725_err_t tcs34725_script_one_shot(tcs34725_script_t*, tcs34725_integration_time_t, bool interrupt, tcs34725_color_t*, uint8_t* status);
+// Write ATIME and CONTROL
+tcs34725_err_t tcs34725_script_configure(tcs34725_script_t*, tcs34725_settings_t);
+// New interrupt thresholds followed by an interrupt clear
+tcs34725_err_t tcs34725_script_rearm(tcs34725_script_t*, uint16_t low, uint16_t high);
+
+// Point the color/status segments of a script at a new sample (e.g. the next element of an array)
+void tcs34725_script_retarget(tcs34725_script_t*, tcs34725_color_t*, uint8_t* status);
+
+// Reference backend running the script with the platform functions of a config (user_ptr is the tcs34725_config_t).
+// Written registers update the register shadow and the settings of the config
+int8_t tcs34725_script_execute(const tcs34725_script_t*, tcs34725_script_done_fptr_t done, void* done_ptr, void* user_ptr);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
@@ -0,0 +1,106 @@
+// Simulated TCS34725 running on a virtual clock.
+//
+// The simulator implements the platform function pointers of
+// tcs34725_config_t so the driver can run without hardware. It models the
+// register map of tcs34725_defs.h, the command register (repeated byte,
+// auto-increment and special function transactions), the PON warm-up,
+// integration and wait timing (ATIME, WTIME, WLONG), AVALID/AINT status,
+// interrupt thresholds with persistence filtering, the data register
+// latching and analog/digital saturation.
+//
+// Time only advances through delay_ms (or tcs34725_sim_advance_us), so
+// hours of sensor time run in milliseconds.
+//
+// Model notes:
+//  - Addresses without TCS34725_COMMAND_BIT are treated like a platform
+//    backend that adds the command bit with the auto-increment protocol
+//  - Integration starts when AEN is set (after the 2.4ms PON warm-up)
+//  - Clearing PON or AEN clears AVALID
+
+#ifndef TCS34725_SIM_H
+#define TCS34725_SIM_H
+
+// C++ guard
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#include <stdbool.h>
+#include "tcs34725_defs.h"
+
+// Maximum number of simulators sharing the virtual clock
+#ifndef TCS34725_SIM_MAX_DEVICES
+#define TCS34725_SIM_MAX_DEVICES (16)
+#endif
+
+// Light reaching the sensor, in counts per 2.4ms integration cycle at 1x gain
+typedef struct {
+    float red;
+    float green;
+    float blue;
+    float clear;
+} tcs34725_sim_light_t;
+
+// Time varying light source (time_us is the virtual time)
+typedef void (*tcs34725_sim_light_fptr_t)(uint64_t time_us, tcs34725_sim_light_t* light, void* user_ptr);
+
+// Device state machine phase
+typedef enum {
+    TCS34725_SIM_SLEEP,        // PON = 0
+    TCS34725_SIM_IDLE,         // PON = 1, AEN = 0
+    TCS34725_SIM_WARMUP,       // AEN set before the PON warm-up completed
+    TCS34725_SIM_INTEGRATING,  // RGBC integration
+    TCS34725_SIM_WAITING,      // Wait timer (WEN = 1)
+} tcs34725_sim_phase_t;
+
+// Simulated device
+typedef struct {
+    uint8_t                   regs[32];           // Register file
+    uint8_t                   pointer;            // Command register address
+    uint8_t                   transaction;        // Command register transaction type
+    uint8_t                   latch[4];           // High byte shadows (latched when the low byte is read)
+    uint64_t                  time_us;            // Virtual clock
+    uint64_t                  phase_end_us;       // End of the current phase
+    uint64_t                  warmup_end_us;      // End of the PON warm-up
+    tcs34725_sim_phase_t      phase;              // Current phase
+    uint8_t                   cycle_atime;        // ATIME latched at the start of the integration
+    float                     accum[4];           // Counts accumulated during the integration (C, R, G, B)
+    uint8_t                   out_of_range;       // Consecutive samples outside the threshold window
+    uint32_t                  cycles;             // Completed integration cycles
+    uint32_t                  fail_next;          // Number of upcoming bus transactions that fail
+    tcs34725_sim_light_t      light;              // Light level (used when light_fn is NULL)
+    tcs34725_sim_light_fptr_t light_fn;           // Time varying light level (optional)
+    void*                     light_user_ptr;     // User pointer for light_fn
+} tcs34725_sim_t;
+
+// Reset the simulated device to its power-on state
+void tcs34725_sim_init(tcs34725_sim_t*, uint8_t id);
+// Point the platform functions of a config at the simulator (also adds it to the shared virtual clock).
+// Returns TCS34725_ERR_INVALID_ARG without touching the config when TCS34725_SIM_MAX_DEVICES are attached
+tcs34725_err_t tcs34725_sim_attach(tcs34725_sim_t*, tcs34725_config_t*);
+// Remove all simulators from the shared virtual clock
+void tcs34725_sim_detach_all(void);
+
+// Light control
+void tcs34725_sim_set_light(tcs34725_sim_t*, tcs34725_sim_light_t);
+void tcs34725_sim_set_light_fn(tcs34725_sim_t*, tcs34725_sim_light_fptr_t, void* user_ptr);
+
+// Advance the virtual clock
+void tcs34725_sim_advance_us(tcs34725_sim_t*, uint64_t us);
+// State of the INT pin (true when asserted)
+bool tcs34725_sim_int_pin(const tcs34725_sim_t*);
+
+// Platform functions (user_ptr is the tcs34725_sim_t, delay advances every attached simulator)
+int8_t tcs34725_sim_read_reg(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr);
+int8_t tcs34725_sim_write_reg(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr);
+int8_t tcs34725_sim_write_byte(uint8_t single_byte, void* user_ptr);
+void tcs34725_sim_delay_ms(uint32_t period);
+uint32_t tcs34725_sim_get_tick_ms(void);
+
+
+#ifdef __cplusplus
+}
+#endif // End of C++ guard
+
+#endif
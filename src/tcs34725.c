@@ -1,30 +1,186 @@
 
 #include <stdlib.h>
 #include <stdbool.h>
+#ifndef TCS34725_FIXED_POINT
 #include <math.h>
+#endif
 #include "tcs34725.h"
 
+// Bus operations are retried this many times before an error is reported
+#ifndef TCS34725_BUS_RETRIES
+#define TCS34725_BUS_RETRIES (0)
+#endif
+
+// Instrumentation hooks, compiled out unless TCS34725_INSTRUMENTATION is defined
+#ifdef TCS34725_INSTRUMENTATION
+#define STAT_ADD(config, field, n) ((config)->instrumentation != NULL ? (void)((config)->instrumentation->stats.field += (n)) : (void)0)
+#define TRACE(config, event, begin) trace((config), (event), (begin))
+static void trace(tcs34725_config_t*, tcs34725_trace_event_t, bool);
+#else
+#define STAT_ADD(config, field, n) ((void)0)
+#define TRACE(config, event, begin) ((void)0)
+#endif
+
 //Internal helper functions for reading and writing registers
+static bool bus_read(uint8_t, uint8_t*, uint32_t, tcs34725_config_t*);
+static bool bus_write(uint8_t, const uint8_t*, uint32_t, tcs34725_config_t*);
+static bool bus_write_byte(uint8_t, tcs34725_config_t*);
+static void sleep_ms(uint32_t, tcs34725_config_t*);
 static tcs34725_err_t write8(uint8_t, uint32_t, tcs34725_config_t*);
+static tcs34725_err_t write_regs(uint8_t, const uint8_t*, uint32_t, tcs34725_config_t*);
 static tcs34725_err_t read8(uint8_t, uint8_t*, tcs34725_config_t*);
-static tcs34725_err_t read16(uint8_t, uint16_t*, tcs34725_config_t*);
+static tcs34725_err_t read8_cached(uint8_t, uint8_t*, tcs34725_config_t*);
+static bool shadow_matches(uint8_t, uint8_t, tcs34725_config_t*);
+static tcs34725_err_t read_block(uint8_t, uint8_t*, uint32_t, tcs34725_config_t*);
+static tcs34725_err_t read_color(tcs34725_color_t*, uint8_t*, tcs34725_config_t*);
+static uint32_t integration_delay_ms(tcs34725_integration_time_t);
+static uint32_t integration_cycle_ms(tcs34725_integration_time_t);
+static tcs34725_err_t wait_valid(tcs34725_color_t*, uint32_t, uint32_t*, tcs34725_config_t*);
+static void ring_push(tcs34725_ring_buffer_t*, const tcs34725_sample_t*);
+static uint32_t gain_factor(tcs34725_gain_t);
+static tcs34725_err_t set_cycle_time(uint32_t, uint32_t*, tcs34725_config_t*);
+static tcs34725_err_t event_window(uint16_t, const tcs34725_event_t*, tcs34725_config_t*);
+
+
+#ifdef TCS34725_INSTRUMENTATION
+static void trace(tcs34725_config_t* config, tcs34725_trace_event_t event, bool begin) {
+    tcs34725_instrumentation_t* inst = config->instrumentation;
+    if(inst != NULL && inst->trace != NULL){
+        // Bus transactions take tens of microseconds, a millisecond tick cannot resolve them
+        uint32_t timestamp = 0;
+        if(inst->get_tick_us != NULL){
+            timestamp = inst->get_tick_us();
+        }else if(config->get_tick_ms != NULL){
+            timestamp = config->get_tick_ms() * 1000;
+        }
+        inst->trace(event, begin, timestamp, inst->trace_user_ptr);
+    }
+}
+#endif
+
+
+static bool bus_read(uint8_t command, uint8_t* data, uint32_t len, tcs34725_config_t* config) {
+    bool ok = false;
+    TRACE(config, TCS34725_TRACE_BUS_READ, true);
+    for(uint32_t attempt = 0; !ok && attempt <= TCS34725_BUS_RETRIES; attempt++){
+        if(attempt > 0){
+            STAT_ADD(config, retries, 1);
+        }
+        STAT_ADD(config, transactions, 1);
+        ok = (config->read_reg(command, data, len, config->user_ptr) == 0);
+    }
+    if(ok){
+        STAT_ADD(config, bytes_read, len);
+    }else{
+        STAT_ADD(config, read_errors, 1);
+    }
+    TRACE(config, TCS34725_TRACE_BUS_READ, false);
+    return ok;
+}
+
+
+static bool bus_write(uint8_t command, const uint8_t* data, uint32_t len, tcs34725_config_t* config) {
+    bool ok = false;
+    TRACE(config, TCS34725_TRACE_BUS_WRITE, true);
+    for(uint32_t attempt = 0; !ok && attempt <= TCS34725_BUS_RETRIES; attempt++){
+        if(attempt > 0){
+            STAT_ADD(config, retries, 1);
+        }
+        STAT_ADD(config, transactions, 1);
+        ok = (config->write_reg(command, data, len, config->user_ptr) == 0);
+    }
+    if(ok){
+        STAT_ADD(config, bytes_written, len);
+    }else{
+        STAT_ADD(config, write_errors, 1);
+    }
+    TRACE(config, TCS34725_TRACE_BUS_WRITE, false);
+    return ok;
+}
+
+
+static bool bus_write_byte(uint8_t byte, tcs34725_config_t* config) {
+    bool ok = false;
+    TRACE(config, TCS34725_TRACE_BUS_WRITE, true);
+    for(uint32_t attempt = 0; !ok && attempt <= TCS34725_BUS_RETRIES; attempt++){
+        if(attempt > 0){
+            STAT_ADD(config, retries, 1);
+        }
+        STAT_ADD(config, transactions, 1);
+        ok = (config->write_byte(byte, config->user_ptr) == 0);
+    }
+    if(!ok){
+        STAT_ADD(config, write_errors, 1);
+    }
+    TRACE(config, TCS34725_TRACE_BUS_WRITE, false);
+    return ok;
+}
+
+
+static void sleep_ms(uint32_t period, tcs34725_config_t* config) {
+    TRACE(config, TCS34725_TRACE_DELAY, true);
+    config->delay_ms(period);
+    STAT_ADD(config, sleep_ms, period);
+    TRACE(config, TCS34725_TRACE_DELAY, false);
+}
 
 
 static tcs34725_err_t write8(uint8_t reg, uint32_t value, tcs34725_config_t* config) {
-    tcs34725_err_t err;
     uint8_t data = (uint8_t) value;
-    if( config->write_reg(reg, &data, 1, config->user_ptr) == 0){
+    return write_regs(reg, &data, 1, config);
+}
+
+
+static bool shadow_matches(uint8_t reg, uint8_t value, tcs34725_config_t* config) {
+    return (reg < sizeof(config->state.shadow)) &&
+           (config->state.shadow_valid & (1U << reg)) &&
+           (config->state.shadow[reg] == value);
+}
+
+
+static tcs34725_err_t write_regs(uint8_t reg, const uint8_t* data, uint32_t len, tcs34725_config_t* config) {
+    tcs34725_err_t err;
+
+    // Trim leading and trailing bytes that the device already holds
+    uint32_t first = 0;
+    uint32_t last = len;
+    while(first < last && shadow_matches(reg + first, data[first], config)){
+        first++;
+    }
+    while(last > first && shadow_matches(reg + last - 1, data[last - 1], config)){
+        last--;
+    }
+    if(first == last){
+        return TCS34725_OK;
+    }
+
+    // Whatever is left goes out as a single (auto-increment) transaction
+    bool written = bus_write(reg + first, &data[first], last - first, config);
+    if(written){
         err = TCS34725_OK;
     }else{
         err = TCS34725_ERR_WRITE;
     }
+
+    // Keep the shadow copy in sync, a failed write leaves the device contents unknown
+    for(uint32_t i = first; i < last; i++){
+        uint8_t r = reg + i;
+        if(r < sizeof(config->state.shadow)){
+            if(written){
+                config->state.shadow[r] = data[i];
+                config->state.shadow_valid |= (1U << r);
+            }else{
+                config->state.shadow_valid &= ~(1U << r);
+            }
+        }
+    }
     return err;
 }
 
 
 static tcs34725_err_t read8(uint8_t reg, uint8_t* data, tcs34725_config_t* config) {
     tcs34725_err_t err;
-    if( config->read_reg(reg, data, sizeof(uint8_t), config->user_ptr) == 0 ){
+    if( bus_read(reg, data, sizeof(uint8_t), config) ){
         err = TCS34725_OK;
     }else{
         err = TCS34725_ERR_READ;
@@ -33,9 +189,25 @@ static tcs34725_err_t read8(uint8_t reg, uint8_t* data, tcs34725_config_t* confi
 }
 
 
-static tcs34725_err_t read16(uint8_t reg, uint16_t* data, tcs34725_config_t* config) {
+static tcs34725_err_t read8_cached(uint8_t reg, uint8_t* data, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+    if(reg < sizeof(config->state.shadow) && (config->state.shadow_valid & (1U << reg))){
+        *data = config->state.shadow[reg];
+    }else{
+        err = read8(reg, data, config);
+        if(err == TCS34725_OK && reg < sizeof(config->state.shadow)){
+            config->state.shadow[reg] = *data;
+            config->state.shadow_valid |= (1U << reg);
+        }
+    }
+    return err;
+}
+
+
+static tcs34725_err_t read_block(uint8_t reg, uint8_t* data, uint32_t len, tcs34725_config_t* config) {
     tcs34725_err_t err;
-    if( config->read_reg(reg, (uint8_t*) data, sizeof(uint16_t), config->user_ptr) == 0 ){
+    // Consecutive registers in a single bus transaction, the platform uses the auto-increment protocol
+    if( bus_read(reg, data, len, config) ){
         err = TCS34725_OK;
     }else{
         err = TCS34725_ERR_READ;
@@ -44,38 +216,126 @@ static tcs34725_err_t read16(uint8_t reg, uint16_t* data, tcs34725_config_t* con
 }
 
 
-tcs34725_err_t tcs34725_enable(tcs34725_config_t* config) {
-    tcs34725_err_t err = TCS34725_OK;
+static tcs34725_err_t read_color(tcs34725_color_t* color, uint8_t* status, tcs34725_config_t* config) {
+    tcs34725_err_t err;
 
-    err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON, config);
-    config->delay_ms(3);
-    err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN, config);
-    /* Set a delay for the integration time.
-       This is only necessary in the case where enabling and then
-       immediately trying to read values back. This is because setting
-       AEN triggers an automatic integration, so if a read RGBC is
-       performed too quickly, the data is not yet valid and all 0's are
-       returned */
-    switch (config->settings.integration_time) {
+    /* Burst read of STATUS (optional) and CDATAL..BDATAH (0x13-0x1B).
+       Reading every channel in one transaction guarantees that all four
+       values come from the same integration cycle since the device latches
+       the data registers for the duration of the transfer */
+    uint8_t buf[1 + 8];
+    uint8_t* data = &buf[1];
+    TRACE(config, TCS34725_TRACE_SAMPLE, true);
+    if(status != NULL){
+        err = read_block(TCS34725_STATUS_REG, buf, sizeof(buf), config);
+        *status = buf[0];
+    }else{
+        err = read_block(TCS34725_CDATAL_REG, data, sizeof(buf) - 1, config);
+    }
+
+    if(err == TCS34725_OK){
+        color->clear = (uint16_t)data[0] | ((uint16_t)data[1] << 8);
+        color->red   = (uint16_t)data[2] | ((uint16_t)data[3] << 8);
+        color->green = (uint16_t)data[4] | ((uint16_t)data[5] << 8);
+        color->blue  = (uint16_t)data[6] | ((uint16_t)data[7] << 8);
+#ifdef TCS34725_INSTRUMENTATION
+        if(color->clear >= tcs34725_calculate_saturation(config->settings.integration_time)){
+            STAT_ADD(config, saturated, 1);
+        }
+#endif
+    }
+    TRACE(config, TCS34725_TRACE_SAMPLE, false);
+    return err;
+}
+
+
+static uint32_t integration_delay_ms(tcs34725_integration_time_t it) {
+    uint32_t period;
+    switch (it) {
     case TCS34725_INTEGRATIONTIME_2_4MS:
-        config->delay_ms(3);
+        period = 3;
         break;
     case TCS34725_INTEGRATIONTIME_24MS:
-        config->delay_ms(24);
+        period = 24;
         break;
     case TCS34725_INTEGRATIONTIME_50MS:
-        config->delay_ms(50);
+        period = 50;
         break;
     case TCS34725_INTEGRATIONTIME_101MS:
-        config->delay_ms(101);
+        period = 101;
         break;
     case TCS34725_INTEGRATIONTIME_154MS:
-        config->delay_ms(154);
+        period = 154;
         break;
     case TCS34725_INTEGRATIONTIME_700MS:
-        config->delay_ms(700);
+        period = 700;
         break;
+    default:
+        // Raw ATIME value, 2.4ms per integration cycle (rounded up)
+        period = ((256 - (uint32_t)it) * 24 + 9) / 10;
+        break;
+    }
+    return period;
+}
+
+
+static uint32_t integration_cycle_ms(tcs34725_integration_time_t it) {
+    /* Actual length of one integration, 2.4ms per cycle rounded up.
+       The table above is shorter for 50ms (50.4ms) and 101ms (103.2ms),
+       which is too early to find a new sample since AVALID is sticky */
+    return ((256 - (uint32_t)it) * 24 + 9) / 10;
+}
+
+
+static tcs34725_err_t wait_valid(tcs34725_color_t* color, uint32_t wait, uint32_t* elapsed, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    /* Sleep for the nominal time of the first sample and then poll AVALID
+       every millisecond in case the oscillator runs slow (up to 25% is
+       tolerated). Status and data come in the same transaction, so the
+       first valid poll is the sample */
+    uint32_t timeout = *elapsed + wait + wait / 4 + 10;
+    sleep_ms(wait, config);
+    *elapsed += wait;
+    while(true){
+        uint8_t status = 0;
+        err |= read_color(color, &status, config);
+        if(err != TCS34725_OK || (status & TCS34727_FLAG_AVALID)){
+            break;
+        }
+        STAT_ADD(config, avalid_misses, 1);
+        if(*elapsed >= timeout){
+            err = TCS34725_ERR_NOT_READY;
+            break;
+        }
+        sleep_ms(1, config);
+        (*elapsed)++;
+    }
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_enable(tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    /* Keep the interrupt enable bit configured by tcs34725_set_interrupt.
+       Without a shadow copy (first init, or after a power loss) the
+       register is written blind instead of spending a read on it */
+    uint8_t reg_val = 0;
+    if(config->state.shadow_valid & (1U << TCS34725_ENABLE_REG)){
+        reg_val = config->state.shadow[TCS34725_ENABLE_REG] & TCS34725_ENABLE_AIEN;
     }
+
+    err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON, config);
+    sleep_ms(3, config);
+    err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN, config);
+    /* Set a delay for the integration time.
+       This is only necessary in the case where enabling and then
+       immediately trying to read values back. This is because setting
+       AEN triggers an automatic integration, so if a read RGBC is
+       performed too quickly, the data is not yet valid and all 0's are
+       returned */
+    sleep_ms(integration_delay_ms(config->settings.integration_time), config);
     return err;
 }
 
@@ -84,8 +344,9 @@ tcs34725_err_t tcs34725_disable(tcs34725_config_t* config) {
     tcs34725_err_t err = TCS34725_OK;
 
     uint8_t reg_val = 0;
-    err |= read8(TCS34725_ENABLE_REG, &reg_val, config);
+    err |= read8_cached(TCS34725_ENABLE_REG, &reg_val, config);
     err |= write8(TCS34725_ENABLE_REG, reg_val & ~(TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN), config);
+    config->state.acquisition = TCS34725_STATE_IDLE;
     return err;
 }
 
@@ -93,6 +354,11 @@ tcs34725_err_t tcs34725_disable(tcs34725_config_t* config) {
 tcs34725_err_t tcs34725_init(tcs34725_config_t* config) {
     tcs34725_err_t err = TCS34725_OK;
 
+    TRACE(config, TCS34725_TRACE_INIT, true);
+
+    // The device may have lost power since the last init, forget what it held
+    tcs34725_invalidate_cache(config);
+
     // Make sure sensor is accessible
     uint8_t id = 0;
     err |= read8(TCS34725_ID_REG, &id, config);
@@ -107,20 +373,209 @@ tcs34725_err_t tcs34725_init(tcs34725_config_t* config) {
 
         // Note: by default, the device is in power down mode on bootup
         err |= tcs34725_enable(config);
+        // A re-init leaves no acquisition in progress
+        config->state.acquisition = TCS34725_STATE_IDLE;
     }
+    TRACE(config, TCS34725_TRACE_INIT, false);
     return err;
 }
 
 
+tcs34725_err_t tcs34725_init_warm(bool* warm, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+    bool reused = false;
+
+    TRACE(config, TCS34725_TRACE_INIT, true);
+
+    // ENABLE through STATUS (0x00-0x13) in one burst, this includes the ID
+    uint8_t regs[TCS34725_STATUS_REG + 1];
+    err |= read_block(TCS34725_ENABLE_REG, regs, sizeof(regs), config);
+    if(err != TCS34725_OK){
+        //Do nothing, read error and err will already have the correct error code
+    }else if( (regs[TCS34725_ID_REG] != TCS34725_ID) && (regs[TCS34725_ID_REG] != 0x10)) {
+        err = TCS34725_ERR_DEVICE_NOT_FOUND;
+    }else{
+        // Seed the shadow copy so that only registers that differ are written
+        const uint16_t writable = (1U << TCS34725_ENABLE_REG) | (1U << TCS34725_ATIME_REG) | (1U << TCS34725_WTIME_REG) |
+                                  (1U << TCS34725_AILTL_REG) | (1U << TCS34725_AILTH_REG) |
+                                  (1U << TCS34725_AIHTL_REG) | (1U << TCS34725_AIHTH_REG) |
+                                  (1U << TCS34725_PERS_REG) | (1U << TCS34725_CONFIG_REG) | (1U << TCS34725_CONTROL_REG);
+        for(uint8_t r = 0; r < sizeof(config->state.shadow); r++){
+            config->state.shadow[r] = regs[r];
+        }
+        config->state.shadow_valid = writable;
+
+        bool running = (regs[TCS34725_ENABLE_REG] & (TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN)) == (TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+        bool unchanged = (regs[TCS34725_ATIME_REG] == (uint8_t)config->settings.integration_time) &&
+                         (regs[TCS34725_CONTROL_REG] == (uint8_t)config->settings.gain);
+
+        err |= tcs34725_set_integration_time(config->settings.integration_time, config);
+        err |= tcs34725_set_gain(config->settings.gain, config);
+
+        if(running && unchanged && (regs[TCS34725_STATUS_REG] & TCS34727_FLAG_AVALID)){
+            // Device kept power and configuration, the data registers already hold a valid sample
+            reused = true;
+        }else if(running){
+            /* Already past the warm-up. AEN has to toggle to restart the
+               integration with the new settings (this also clears the
+               sticky AVALID), then wait until the new sample is complete */
+            uint8_t reg_val = regs[TCS34725_ENABLE_REG] & TCS34725_ENABLE_AIEN;
+            err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON, config);
+            err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN, config);
+            tcs34725_color_t sample;
+            uint32_t elapsed = 0;
+            if(err == TCS34725_OK){
+                err |= wait_valid(&sample, integration_cycle_ms(config->settings.integration_time), &elapsed, config);
+            }
+        }else{
+            err |= tcs34725_enable(config);
+        }
+        config->state.acquisition = TCS34725_STATE_IDLE;
+    }
+
+    if(warm != NULL){
+        *warm = reused;
+    }
+    TRACE(config, TCS34725_TRACE_INIT, false);
+    return err;
+}
+
+
+void tcs34725_invalidate_cache(tcs34725_config_t* config) {
+    config->state.shadow_valid = 0;
+}
+
+
 tcs34725_err_t tcs34725_set_integration_time(tcs34725_integration_time_t it, tcs34725_config_t* config) {
     // Update the timing register
-    return write8(TCS34725_ATIME_REG, it, config);
+    tcs34725_err_t err = write8(TCS34725_ATIME_REG, it, config);
+    if(err == TCS34725_OK){
+        // Keep the config in sync so delays and saturation limits follow the device
+        config->settings.integration_time = it;
+    }
+    return err;
 }
 
 
 tcs34725_err_t tcs34725_set_gain(tcs34725_gain_t gain, tcs34725_config_t* config) {
-    // Update the timing register
-    return write8(TCS34725_CONTROL_REG, gain, config);
+    // Update the control register
+    tcs34725_err_t err = write8(TCS34725_CONTROL_REG, gain, config);
+    if(err == TCS34725_OK){
+        config->settings.gain = gain;
+    }
+    return err;
+}
+
+
+static uint32_t gain_factor(tcs34725_gain_t gain) {
+    uint32_t factor;
+    switch (gain) {
+    case TCS34725_GAIN_4X:
+        factor = 4;
+        break;
+    case TCS34725_GAIN_16X:
+        factor = 16;
+        break;
+    case TCS34725_GAIN_60X:
+        factor = 60;
+        break;
+    case TCS34725_GAIN_1X:
+    default:
+        factor = 1;
+        break;
+    }
+    return factor;
+}
+
+
+tcs34725_err_t tcs34725_agc_update(tcs34725_color_t color, const tcs34725_agc_t* agc, bool* changed, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    // Candidate settings, integration times in ascending order and gains in descending order
+    static const tcs34725_integration_time_t times[] = {
+        TCS34725_INTEGRATIONTIME_2_4MS, TCS34725_INTEGRATIONTIME_24MS, TCS34725_INTEGRATIONTIME_50MS,
+        TCS34725_INTEGRATIONTIME_101MS, TCS34725_INTEGRATIONTIME_154MS, TCS34725_INTEGRATIONTIME_700MS,
+    };
+    static const tcs34725_gain_t gains[] = {
+        TCS34725_GAIN_60X, TCS34725_GAIN_16X, TCS34725_GAIN_4X, TCS34725_GAIN_1X,
+    };
+
+    tcs34725_integration_time_t it = config->settings.integration_time;
+    tcs34725_gain_t gain = config->settings.gain;
+    uint32_t cycles = 256 - (uint32_t)it;
+    uint16_t sat = tcs34725_calculate_saturation(it);
+    bool saturated = (color.clear >= sat);
+
+    /* Light level in clear counts per integration cycle at 1x gain (scaled by 1024).
+       A saturated sample only gives a lower bound, assume 4x more light so
+       that a bright step is followed in a few iterations */
+    uint64_t clear = (color.clear > 0) ? color.clear : 1;
+    if(saturated){
+        clear = (uint64_t)sat * 4;
+    }
+    uint64_t rate = (clear * 1024) / (gain_factor(gain) * cycles);
+
+    /* Pick the shortest integration (lowest latency) that still reaches
+       min_counts with some headroom, using the highest gain that stays
+       below the saturation level. Fall back to the most sensitive
+       setting within the latency budget that does not saturate.
+       After a saturated sample the estimate is only a lower bound and
+       the saturation limit is not monotonic across integration times,
+       so only settings with a shorter integration and/or a lower gain
+       are considered. If none fits, the least sensitive setting (2.4ms,
+       1x) is used */
+    uint32_t hyst = agc->hysteresis;
+    uint64_t target = (uint64_t)agc->min_counts * (100 + hyst) / 100;
+    tcs34725_integration_time_t best_it = times[0];
+    tcs34725_gain_t best_gain = TCS34725_GAIN_1X;
+    uint64_t best_counts = 0;
+    bool found = false;
+    for(size_t t = 0; t < sizeof(times) / sizeof(times[0]) && !found; t++){
+        if(agc->max_integration_ms != 0 && integration_delay_ms(times[t]) > agc->max_integration_ms){
+            break;
+        }
+        uint64_t limit = (uint64_t)tcs34725_calculate_saturation(times[t]) * (100 - hyst) / 100;
+        for(size_t g = 0; g < sizeof(gains) / sizeof(gains[0]); g++){
+            if(saturated && ((256 - (uint32_t)times[t]) > cycles || gain_factor(gains[g]) > gain_factor(gain) ||
+                             (times[t] == it && gains[g] == gain))){
+                continue;
+            }
+            uint64_t counts = rate * gain_factor(gains[g]) * (256 - (uint32_t)times[t]) / 1024;
+            if(counts <= limit){
+                // Ties (a dark sample estimates 0 counts everywhere) go to the more sensitive setting
+                if(counts >= best_counts){
+                    best_it = times[t];
+                    best_gain = gains[g];
+                    best_counts = counts;
+                }
+                found = (counts >= target);
+                break;
+            }
+        }
+    }
+
+    /* Hysteresis: keep the current setting while it is neither saturated
+       nor short of min_counts, unless a shorter integration is available */
+    bool keep = !saturated &&
+                (color.clear >= agc->min_counts || (best_it == it && best_gain == gain)) &&
+                (256 - (uint32_t)best_it) >= cycles;
+    if(agc->max_integration_ms != 0 && integration_delay_ms(it) > agc->max_integration_ms){
+        keep = false;
+    }
+
+    *changed = false;
+    if(!keep && (best_it != it || best_gain != gain)){
+        /* Note: the cycle in progress was started with the old settings,
+           so the next sample should be discarded */
+        if(best_gain != gain){
+            err |= tcs34725_set_gain(best_gain, config);
+        }
+        if(best_it != it){
+            err |= tcs34725_set_integration_time(best_it, config);
+        }
+        *changed = true;
+    }
+    return err;
 }
 
 
@@ -128,47 +583,362 @@ tcs34725_err_t tcs34725_get_raw_data(tcs34725_color_t* color, tcs34725_config_t*
 
     tcs34725_err_t err = TCS34725_OK;
 
-    err |= read16(TCS34725_CDATAL_REG, &(color->clear), config);
-    err |= read16(TCS34725_RDATAL_REG, &(color->red),   config);
-    err |= read16(TCS34725_GDATAL_REG, &(color->green), config);
-    err |= read16(TCS34725_BDATAL_REG, &(color->blue),  config);
+    err |= read_color(color, NULL, config);
 
     // Set a delay for the integration time
-    switch (config->settings.integration_time) {
-    case TCS34725_INTEGRATIONTIME_2_4MS:
-        config->delay_ms(3);
-        break;
-    case TCS34725_INTEGRATIONTIME_24MS:
-        config->delay_ms(24);
+    sleep_ms(integration_delay_ms(config->settings.integration_time), config);
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_get_raw_data_burst(tcs34725_color_t* color, uint8_t* status, tcs34725_config_t* config) {
+    // Single transaction, no delay. The caller decides what to do with a sample that is not AVALID
+    return read_color(color, status, config);
+}
+
+
+tcs34725_err_t tcs34725_get_raw_data_one_shot(tcs34725_color_t* color, tcs34725_config_t* config) {
+    return tcs34725_one_shot(color, NULL, config);
+}
+
+
+tcs34725_err_t tcs34725_one_shot(tcs34725_color_t* color, uint32_t* time_to_sample_ms, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+    uint32_t elapsed = 0;
+    uint32_t start = (config->get_tick_ms != NULL) ? config->get_tick_ms() : 0;
+    TRACE(config, TCS34725_TRACE_ONE_SHOT, true);
+
+    // Keep the interrupt enable bit, PON/AEN/WEN are controlled here
+    uint8_t reg_val = 0;
+    err |= read8_cached(TCS34725_ENABLE_REG, &reg_val, config);
+    bool powered = (reg_val & TCS34725_ENABLE_PON);
+    bool running = powered && (reg_val & TCS34725_ENABLE_AEN);
+    reg_val &= TCS34725_ENABLE_AIEN;
+
+    if(!powered){
+        // The 2.4ms oscillator warm-up is only needed if the device is asleep
+        err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON, config);
+        sleep_ms(3, config);
+        elapsed += 3;
+    }else if(running){
+        // AEN has to toggle to restart the integration, the data registers may hold an older sample
+        err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON, config);
+    }
+    err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN, config);
+
+    // Nominal integration time is 2.4ms per cycle (rounded up)
+    if(err == TCS34725_OK){
+        err |= wait_valid(color, integration_cycle_ms(config->settings.integration_time), &elapsed, config);
+    }
+
+    // Power down with a single write
+    err |= write8(TCS34725_ENABLE_REG, reg_val, config);
+    config->state.acquisition = TCS34725_STATE_IDLE;
+
+    if(time_to_sample_ms != NULL){
+        *time_to_sample_ms = (config->get_tick_ms != NULL) ? (config->get_tick_ms() - start) : elapsed;
+    }
+    TRACE(config, TCS34725_TRACE_ONE_SHOT, false);
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_start(tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    if(config->get_tick_ms == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    if(config->state.acquisition == TCS34725_STATE_IDLE){
+        // Power on only, AEN is set by tcs34725_poll once the oscillator has settled
+        uint8_t reg_val = 0;
+        err |= read8_cached(TCS34725_ENABLE_REG, &reg_val, config);
+        err |= write8(TCS34725_ENABLE_REG, (reg_val & TCS34725_ENABLE_AIEN) | TCS34725_ENABLE_PON, config);
+        config->state.acquisition = TCS34725_STATE_POWER_ON;
+    }else{
+        // Already running, wait for a full integration cycle from now
+        config->state.acquisition = TCS34725_STATE_INTEGRATING;
+    }
+    config->state.timestamp = config->get_tick_ms();
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_poll(bool* ready, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    if(config->get_tick_ms == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    uint32_t now = config->get_tick_ms();
+    uint32_t elapsed = now - config->state.timestamp;
+
+    switch (config->state.acquisition) {
+    case TCS34725_STATE_POWER_ON:
+        // 2.4ms warm-up is required between PON and AEN
+        if(elapsed >= 3){
+            // Keep the interrupt enable bit configured by tcs34725_set_interrupt
+            uint8_t reg_val = 0;
+            err |= read8_cached(TCS34725_ENABLE_REG, &reg_val, config);
+            reg_val &= TCS34725_ENABLE_AIEN;
+            err |= write8(TCS34725_ENABLE_REG, reg_val | TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN, config);
+            config->state.acquisition = TCS34725_STATE_INTEGRATING;
+            config->state.timestamp = now;
+        }
         break;
-    case TCS34725_INTEGRATIONTIME_50MS:
-        config->delay_ms(50);
+    case TCS34725_STATE_INTEGRATING:
+        /* Only touch the bus once a full integration cycle has elapsed,
+           so that a cycle boundary lies between the last fetch and now.
+           The status and data registers are read together so that
+           tcs34725_fetch does not need another transaction */
+        if(elapsed >= integration_cycle_ms(config->settings.integration_time)){
+            uint8_t status = 0;
+            err |= read_color(&config->state.sample, &status, config);
+            if(err == TCS34725_OK && (status & TCS34727_FLAG_AVALID)){
+                config->state.acquisition = TCS34725_STATE_READY;
+            }else if(err == TCS34725_OK){
+                STAT_ADD(config, avalid_misses, 1);
+            }
+        }
         break;
-    case TCS34725_INTEGRATIONTIME_101MS:
-        config->delay_ms(101);
+    case TCS34725_STATE_IDLE:
+    case TCS34725_STATE_READY:
+    case TCS34725_STATE_CONTINUOUS:
+    case TCS34725_STATE_EVENT:
         break;
-    case TCS34725_INTEGRATIONTIME_154MS:
-        config->delay_ms(154);
+    }
+
+    *ready = (config->state.acquisition == TCS34725_STATE_READY);
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_fetch(tcs34725_color_t* color, tcs34725_config_t* config) {
+    if(config->state.acquisition != TCS34725_STATE_READY){
+        return TCS34725_ERR_NOT_READY;
+    }
+
+    *color = config->state.sample;
+
+    // The device keeps integrating, the next sample completes within one integration cycle from now
+    config->state.acquisition = TCS34725_STATE_INTEGRATING;
+    config->state.timestamp = config->get_tick_ms();
+    return TCS34725_OK;
+}
+
+
+uint32_t tcs34725_next_poll_ms(tcs34725_config_t* config) {
+    uint32_t period;
+    switch (config->state.acquisition) {
+    case TCS34725_STATE_POWER_ON:
+        period = 3;
         break;
-    case TCS34725_INTEGRATIONTIME_700MS:
-        config->delay_ms(700);
+    case TCS34725_STATE_INTEGRATING:
+        period = integration_cycle_ms(config->settings.integration_time);
         break;
+    default:
+        // tcs34725_poll does not touch the bus in the other states
+        return 0;
+    }
+
+    uint32_t elapsed = config->get_tick_ms() - config->state.timestamp;
+    return (elapsed >= period) ? 0 : (period - elapsed);
+}
+
+
+static tcs34725_err_t set_cycle_time(uint32_t period_ms, uint32_t* actual_period_ms, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    /* Cycle time = integration time + wait time.
+       Work in tenths of a millisecond: 2.4ms per wait step, 28.8ms with WLONG */
+    uint32_t integration = (256 - (uint32_t)config->settings.integration_time) * 24;
+    uint32_t wait = (period_ms * 10 > integration) ? (period_ms * 10 - integration) : 0;
+    uint32_t steps = (wait + 12) / 24;
+    uint8_t config_reg = 0;
+    if(steps > 256){
+        steps = (wait + 144) / 288;
+        config_reg = TCS34725_CONFIG_WLONG;
+        if(steps > 256){
+            steps = 256;
+        }
+    }
+    if(steps == 0){
+        // WTIME = 0xFF is the shortest wait possible
+        steps = 1;
     }
+
+    err |= write8(TCS34725_WTIME_REG, 256 - steps, config);
+    err |= write8(TCS34725_CONFIG_REG, config_reg, config);
+    *actual_period_ms = (integration + steps * (config_reg ? 288 : 24) + 9) / 10;
     return err;
 }
 
 
-tcs34725_err_t tcs34725_get_raw_data_one_shot(tcs34725_color_t* color, tcs34725_config_t* config) {
+tcs34725_err_t tcs34725_start_continuous(uint32_t period_ms, uint32_t* actual_period_ms, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    if(config->ring == NULL || config->ring->capacity == 0){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    err |= set_cycle_time(period_ms, &config->state.period_ms, config);
+    // AINT is raised at the end of every cycle and used to detect fresh samples
+    err |= write8(TCS34725_PERS_REG, TCS34725_PERS_NONE, config);
+    err |= tcs34725_clear_interrupt(config);
+
+    err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON, config);
+    sleep_ms(3, config);
+    err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN | TCS34725_ENABLE_WEN, config);
+
+    config->state.acquisition = TCS34725_STATE_CONTINUOUS;
+    config->state.timestamp = (config->get_tick_ms != NULL) ? config->get_tick_ms() : 0;
+    if(actual_period_ms != NULL){
+        *actual_period_ms = config->state.period_ms;
+    }
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_service_continuous(tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    if(config->state.acquisition != TCS34725_STATE_CONTINUOUS){
+        return TCS34725_ERR_NOT_READY;
+    }
+
+    // With a tick source the bus is only read once per sample period
+    uint32_t now = 0;
+    if(config->get_tick_ms != NULL){
+        now = config->get_tick_ms();
+        if(now - config->state.timestamp < config->state.period_ms){
+            return TCS34725_OK;
+        }
+    }
+
+    tcs34725_sample_t sample;
+    err |= read_color(&sample.color, &sample.status, config);
+    if(err == TCS34725_OK && (sample.status & TCS34727_FLAG_AINT)){
+        sample.timestamp = now;
+        ring_push(config->ring, &sample);
+        err |= tcs34725_clear_interrupt(config);
+        // Only reschedule on a fresh sample so a late cycle is retried on the next call
+        config->state.timestamp = now;
+    }
+    return err;
+}
+
+
+static tcs34725_err_t event_window(uint16_t clear, const tcs34725_event_t* event, tcs34725_config_t* config) {
+    uint32_t delta = ((uint32_t)clear * event->hysteresis_percent) / 100;
+    if(delta < event->hysteresis){
+        delta = event->hysteresis;
+    }
+    uint16_t low = (clear > delta) ? (uint16_t)(clear - delta) : 0;
+    uint16_t high = ((uint32_t)clear + delta < 0xFFFF) ? (uint16_t)(clear + delta) : 0xFFFF;
+    return tcs34725_set_int_limits(low, high, config);
+}
+
+
+tcs34725_err_t tcs34725_event_start(const tcs34725_event_t* event, tcs34725_color_t* color, tcs34725_config_t* config) {
     tcs34725_err_t err = TCS34725_OK;
 
-    err |= tcs34725_enable(config);
-    err |= tcs34725_get_raw_data(color, config);
-    err |= tcs34725_disable(config);
+    /* PERS_NONE interrupts on every cycle whatever the window (and is what a
+       zero initialised event holds), which would turn event mode back into polling */
+    if(event->persistence == TCS34725_PERS_NONE || event->persistence > TCS34725_PERS_60_CYCLE){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    uint8_t enable = TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN;
+    uint32_t delay = integration_cycle_ms(config->settings.integration_time);
+    if(event->period_ms > 0){
+        err |= set_cycle_time(event->period_ms, &config->state.period_ms, config);
+        enable |= TCS34725_ENABLE_WEN;
+        delay = config->state.period_ms;
+    }
+    err |= write8(TCS34725_PERS_REG, event->persistence, config);
+
+    // Interrupts stay masked until the window has been centered on a first sample
+    err |= write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON, config);
+    sleep_ms(3, config);
+    err |= write8(TCS34725_ENABLE_REG, enable, config);
+
+    // The window is centered on the first sample, so wait until AVALID says it is complete
+    tcs34725_color_t sample;
+    uint32_t elapsed = 0;
+    if(err == TCS34725_OK){
+        err |= wait_valid(&sample, delay, &elapsed, config);
+    }
+    if(err != TCS34725_OK){
+        return err;
+    }
+    err |= event_window(sample.clear, event, config);
+    err |= tcs34725_clear_interrupt(config);
+    err |= write8(TCS34725_ENABLE_REG, enable | TCS34725_ENABLE_AIEN, config);
+
+    config->state.acquisition = TCS34725_STATE_EVENT;
+    if(color != NULL){
+        *color = sample;
+    }
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_event_handle(tcs34725_color_t* color, bool* changed, const tcs34725_event_t* event, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
 
+    *changed = false;
+    if(config->state.acquisition != TCS34725_STATE_EVENT){
+        return TCS34725_ERR_NOT_READY;
+    }
+
+    uint8_t status = 0;
+    err |= read_color(color, &status, config);
+    if(err == TCS34725_OK && (status & TCS34727_FLAG_AINT)){
+        /* Move the window before releasing the interrupt, otherwise the
+           next cycle would compare against the old limits and fire again */
+        err |= event_window(color->clear, event, config);
+        err |= tcs34725_clear_interrupt(config);
+        *changed = true;
+    }
     return err;
 }
 
 
+static void ring_push(tcs34725_ring_buffer_t* ring, const tcs34725_sample_t* sample) {
+    uint16_t tail = (uint16_t)((ring->head + ring->count) % ring->capacity);
+    ring->samples[tail] = *sample;
+    if(ring->count < ring->capacity){
+        ring->count++;
+    }else{
+        // Full, the oldest sample was overwritten
+        ring->head = (uint16_t)((ring->head + 1) % ring->capacity);
+        ring->overruns++;
+    }
+}
+
+
+void tcs34725_ring_init(tcs34725_ring_buffer_t* ring, tcs34725_sample_t* storage, uint16_t capacity) {
+    ring->samples = storage;
+    ring->capacity = capacity;
+    ring->head = 0;
+    ring->count = 0;
+    ring->overruns = 0;
+}
+
+
+bool tcs34725_ring_pop(tcs34725_ring_buffer_t* ring, tcs34725_sample_t* sample) {
+    if(ring->count == 0){
+        return false;
+    }
+    *sample = ring->samples[ring->head];
+    ring->head = (uint16_t)((ring->head + 1) % ring->capacity);
+    ring->count--;
+    return true;
+}
+
+
 tcs34725_err_t tcs34725_get_normalized_RGB(tcs34725_normalized_color_t* normalized_color, tcs34725_config_t* config) {
     tcs34725_err_t err = TCS34725_OK;
 
@@ -176,16 +946,25 @@ tcs34725_err_t tcs34725_get_normalized_RGB(tcs34725_normalized_color_t* normaliz
     err = tcs34725_get_raw_data(&color, config);
 
     if(err == TCS34725_OK){
-        uint32_t sum = color.clear;
         // Check for a divide by zero error
         if (color.clear == 0) {
             normalized_color->red = 0;
             normalized_color->green = 0;
             normalized_color->blue = 0;
         }else{
+#ifdef TCS34725_FIXED_POINT
+            // Integer division, only the final scaling is done in floating point
+            tcs34725_normalized_color_fixed_t fixed;
+            tcs34725_calculate_normalized_RGB_fixed(color, &fixed);
+            normalized_color->red   = fixed.red   * (1.0F / (1 << TCS34725_FIXED_FRAC_BITS));
+            normalized_color->green = fixed.green * (1.0F / (1 << TCS34725_FIXED_FRAC_BITS));
+            normalized_color->blue  = fixed.blue  * (1.0F / (1 << TCS34725_FIXED_FRAC_BITS));
+#else
+            uint32_t sum = color.clear;
             normalized_color->red   = (float)color.red   / sum * 255.0;
             normalized_color->green = (float)color.green / sum * 255.0;
             normalized_color->blue  = (float)color.blue  / sum * 255.0;
+#endif
         }
     }
     return err;
@@ -193,6 +972,9 @@ tcs34725_err_t tcs34725_get_normalized_RGB(tcs34725_normalized_color_t* normaliz
 
 
 uint16_t tcs34725_calculate_color_temperature(tcs34725_color_t color) {
+#ifdef TCS34725_FIXED_POINT
+    return tcs34725_calculate_color_temperature_fixed(color);
+#else
     float X, Y, Z; // RGB to XYZ correlation
     float xc, yc;  // Chromaticity co-ordinates
     float n;       // McCamy's formula
@@ -222,17 +1004,12 @@ uint16_t tcs34725_calculate_color_temperature(tcs34725_color_t color) {
 
     // Return the results in degrees Kelvin
     return (uint16_t)cct;
+#endif
 }
 
 
-uint16_t tcs34725_calculate_color_temperature_dn40(tcs34725_color_t color, tcs34725_config_t* config) {
-    uint16_t r2, b2; // RGB values minus IR component
-    uint16_t sat;    // Digital saturation level
-    uint16_t ir;     // Inferred IR content
-
-    if (color.clear == 0) {
-        return 0;
-    }
+uint16_t tcs34725_calculate_saturation(tcs34725_integration_time_t it) {
+    uint16_t sat;
 
     /* Analog/Digital saturation:
      *
@@ -246,12 +1023,12 @@ uint16_t tcs34725_calculate_color_temperature_dn40(tcs34725_color_t color, tcs34
      *     occur before analog saturation. Digital saturation occurs when
      *     the count reaches 65535.
      */
-    if ((256 - config->settings.integration_time) > 63) {
+    if ((256 - it) > 63) {
         // Track digital saturation
         sat = 65535;
     } else {
         // Track analog saturation
-        sat = 1024 * (256 - config->settings.integration_time);
+        sat = 1024 * (256 - it);
     }
 
     /* Ripple rejection:
@@ -271,47 +1048,129 @@ uint16_t tcs34725_calculate_color_temperature_dn40(tcs34725_color_t color, tcs34
      *     ignored, but <= 150ms you should calculate the 75% saturation
      *     level to avoid this problem.
      */
-    if ((256 - config->settings.integration_time) <= 63) {
+    if ((256 - it) <= 63) {
         // Adjust sat to 75% to avoid analog saturation if atime < 153.6ms
         sat -= sat / 4;
     }
+    return sat;
+}
 
-    // Check for saturation and mark the sample as invalid if true
-    if (color.clear >= sat) {
-        return 0;
-    }
 
-    // AMS RGB sensors have no IR channel, so the IR content must be calculated indirectly
-    if(color.red + color.green + color.blue > color.clear){
-        ir = (color.red + color.green + color.blue - color.clear) / 2;
+uint16_t tcs34725_calculate_color_temperature_dn40(tcs34725_color_t color, tcs34725_config_t* config) {
+    // Saturated samples are marked as invalid (0)
+    return tcs34725_dn40(color, tcs34725_calculate_saturation(config->settings.integration_time));
+}
+
+
+uint16_t tcs34725_calculate_lux(tcs34725_color_t color) {
+#ifdef TCS34725_FIXED_POINT
+    return tcs34725_calculate_lux_fixed(color);
+#else
+    float illuminance;
+
+    /* This only uses RGB ... how can we integrate clear or calculate lux
+       based exclusively on clear since this might be more reliable? */
+    illuminance = (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+
+    return (uint16_t) illuminance;
+#endif
+}
+
+
+/* Fixed point conversions
+ *
+ * Integer only versions of the conversion helpers for targets without an
+ * FPU. Define TCS34725_FIXED_POINT to route the float based functions
+ * through them (math.h is then not needed). The DN40 color temperature
+ * is already integer only and is shared by both builds.
+ *
+ * Error bounds against the float versions, measured over a sweep of the
+ * 16-bit channel space (grid plus random samples):
+ *   normalized RGB   |error| <= 0.002 (0.5 LSB) for channels <= clear
+ *   lux              |error| <= 2 while the float result is in 0-65534
+ *   CCT (McCamy)     |error| <= 4K while the float result is in 1000K-20000K
+ *                    (the float version is itself up to 2.3K away from a
+ *                    double precision reference, the fixed one 1.4K)
+ */
+void tcs34725_calculate_normalized_RGB_fixed(tcs34725_color_t color, tcs34725_normalized_color_fixed_t* normalized_color) {
+    if (color.clear == 0) {
+        normalized_color->red = 0;
+        normalized_color->green = 0;
+        normalized_color->blue = 0;
     }else{
-        ir = 0;
+        // 65535 * 255 * 256 + 32767 still fits in 32 bits, results are rounded to nearest
+        uint32_t half = color.clear / 2;
+        normalized_color->red   = ((uint32_t)color.red   * (255U << TCS34725_FIXED_FRAC_BITS) + half) / color.clear;
+        normalized_color->green = ((uint32_t)color.green * (255U << TCS34725_FIXED_FRAC_BITS) + half) / color.clear;
+        normalized_color->blue  = ((uint32_t)color.blue  * (255U << TCS34725_FIXED_FRAC_BITS) + half) / color.clear;
     }
+}
 
-    // Remove the IR component from the raw RGB values
-    r2 = color.red - ir;
-    b2 = color.blue - ir;
 
-    if (r2 == 0) {
+tcs34725_err_t tcs34725_get_normalized_RGB_fixed(tcs34725_normalized_color_fixed_t* normalized_color, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    tcs34725_color_t color;
+    err = tcs34725_get_raw_data(&color, config);
+    if(err == TCS34725_OK){
+        tcs34725_calculate_normalized_RGB_fixed(color, normalized_color);
+    }
+    return err;
+}
+
+
+uint16_t tcs34725_calculate_color_temperature_fixed(tcs34725_color_t color) {
+    if (color.red == 0 && color.green == 0 && color.blue == 0) {
         return 0;
     }
 
-    /* A simple method of measuring color temp is to use the ratio of blue
-       to red light, taking IR cancellation into account. */
-    uint16_t cct = (3810 * (uint32_t)b2) / (uint32_t)r2 + 1391;
+    /* McCamy's n = (xc - 0.3320) / (0.1858 - yc) with xc = X/(X+Y+Z) and
+       yc = Y/(X+Y+Z) reduces to (X - 0.3320*S) / (0.1858*S - Y) with
+       S = X+Y+Z. Both terms are linear in RGB, so the XYZ matrix folds into
+       two rows of Q24 coefficients. The rows nearly cancel for some inputs,
+       so 64-bit sums are used to keep the precision above that of float */
+    int64_t num = ( 4006634LL * color.red) + ( 4278041LL * color.green) + (-9779607LL * color.blue);
+    int64_t den = ( 1863662LL * color.red) + (-14328723LL * color.green) + ( 8772555LL * color.blue);
+    if (den == 0) {
+        return 0;
+    }
 
-    return cct;
-}
+    // n in Q16, clamped to a range where the cubic cannot overflow
+    int64_t n = (num * 65536) / den;
+    if (n > (8 << 16)) {
+        n = 8 << 16;
+    } else if (n < -(8 << 16)) {
+        n = -(8 << 16);
+    }
 
+    // CCT = 449n^3 + 3525n^2 + 6823.3n + 5520.33 (Horner's method, Q16)
+    int64_t cct = 449 * n + ((int64_t)3525 << 16);
+    cct = (cct * n) / 65536 + 447171789;
+    cct = (cct * n) / 65536 + 361780347;
 
-uint16_t tcs34725_calculate_lux(tcs34725_color_t color) {
-    float illuminance;
+    // Out of range results saturate (the float version leaves them undefined)
+    if (cct < 0) {
+        return 0;
+    } else if (cct >= ((int64_t)65535 << 16)) {
+        return 65535;
+    }
+    return (uint16_t)(cct >> 16);
+}
 
-    /* This only uses RGB ... how can we integrate clear or calculate lux
-       based exclusively on clear since this might be more reliable? */
-    illuminance = (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
 
-    return (uint16_t) illuminance;
+uint16_t tcs34725_calculate_lux_fixed(tcs34725_color_t color) {
+    /* Y row of the XYZ matrix in Q15. The positive and negative terms are
+       accumulated separately so that unsigned 32-bit arithmetic is enough */
+    uint32_t pos = 51720U * color.green;
+    uint32_t neg = (10638U * color.red) + (23983U * color.blue);
+
+    // Out of range illuminance saturates (the float version leaves it undefined)
+    if (pos <= neg) {
+        return 0;
+    } else if (((pos - neg) >> 15) > 65535) {
+        return 65535;
+    }
+    return (uint16_t)((pos - neg) >> 15);
 }
 
 
@@ -319,7 +1178,7 @@ tcs34725_err_t tcs34725_set_interrupt(bool interrupt, tcs34725_config_t* config)
     tcs34725_err_t err = TCS34725_OK;
 
     uint8_t reg_val = 0;
-    err |= read8(TCS34725_ENABLE_REG, &reg_val, config);
+    err |= read8_cached(TCS34725_ENABLE_REG, &reg_val, config);
     if (interrupt) {
         reg_val |= TCS34725_ENABLE_AIEN;
     } else {
@@ -332,7 +1191,7 @@ tcs34725_err_t tcs34725_set_interrupt(bool interrupt, tcs34725_config_t* config)
 
 tcs34725_err_t tcs34725_clear_interrupt(tcs34725_config_t* config) {
     tcs34725_err_t err;
-    if( config->write_byte(TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_SF_MODE, TCS34725_SF_INT_CLEAR), config->user_ptr) == 0){
+    if( bus_write_byte(TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_SF_MODE, TCS34725_SF_INT_CLEAR), config) ){
         err = TCS34725_OK;
     }else{
         err = TCS34725_ERR_WRITE;
@@ -342,10 +1201,12 @@ tcs34725_err_t tcs34725_clear_interrupt(tcs34725_config_t* config) {
 
 
 tcs34725_err_t tcs34725_set_int_limits(uint16_t low, uint16_t high, tcs34725_config_t* config) {
-    tcs34725_err_t err = TCS34725_OK;
-    err |= write8(TCS34725_AILTL_REG, low & 0xFF , config);
-    err |= write8(TCS34725_AILTH_REG, low >> 8   , config);
-    err |= write8(TCS34725_AIHTL_REG, high & 0xFF, config);
-    err |= write8(TCS34725_AIHTH_REG, high >> 8  , config);
-    return err;
+    // AILTL, AILTH, AIHTL and AIHTH are adjacent, only the bytes that changed are written (in one transaction)
+    uint8_t limits[4] = {
+        (uint8_t)(low & 0xFF),
+        (uint8_t)(low >> 8),
+        (uint8_t)(high & 0xFF),
+        (uint8_t)(high >> 8),
+    };
+    return write_regs(TCS34725_AILTL_REG, limits, sizeof(limits), config);
 }
\ No newline at end of file
@@ -0,0 +1,274 @@
+#include <stdbool.h>
+#include "tcs34725.h"
+#include "tcs34725_batch.h"
+
+// Number of samples converted per chunk when going from AoS to SoA (stack buffers)
+#define BATCH_CHUNK (256)
+
+
+/* Explicit SIMD paths
+ *
+ * A minimal vector abstraction so each kernel is written once. Operations
+ * are applied in the same order as the scalar code so that the results
+ * are identical, lanes that would divide by zero are forced to 0 just like
+ * the scalar checks do.
+ */
+#if !defined(TCS34725_BATCH_NO_SIMD) && defined(__AVX2__)
+#include <immintrin.h>
+#define SIMD_WIDTH 8
+typedef __m256 vfloat_t;
+static inline vfloat_t v_load_u16(const uint16_t* p) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu16_epi32(_mm_loadu_si128((const __m128i*)p)));
+}
+static inline vfloat_t v_set(float f) { return _mm256_set1_ps(f); }
+static inline vfloat_t v_add(vfloat_t a, vfloat_t b) { return _mm256_add_ps(a, b); }
+static inline vfloat_t v_mul(vfloat_t a, vfloat_t b) { return _mm256_mul_ps(a, b); }
+static inline vfloat_t v_div(vfloat_t a, vfloat_t b) { return _mm256_div_ps(a, b); }
+static inline vfloat_t v_zero_if_zero(vfloat_t v, vfloat_t d) {
+    return _mm256_and_ps(v, _mm256_cmp_ps(d, _mm256_setzero_ps(), _CMP_NEQ_OQ));
+}
+static inline void v_store(float* p, vfloat_t v) { _mm256_storeu_ps(p, v); }
+#elif !defined(TCS34725_BATCH_NO_SIMD) && defined(__SSE2__)
+#include <emmintrin.h>
+#define SIMD_WIDTH 4
+typedef __m128 vfloat_t;
+static inline vfloat_t v_load_u16(const uint16_t* p) {
+    __m128i v = _mm_loadl_epi64((const __m128i*)p);
+    return _mm_cvtepi32_ps(_mm_unpacklo_epi16(v, _mm_setzero_si128()));
+}
+static inline vfloat_t v_set(float f) { return _mm_set1_ps(f); }
+static inline vfloat_t v_add(vfloat_t a, vfloat_t b) { return _mm_add_ps(a, b); }
+static inline vfloat_t v_mul(vfloat_t a, vfloat_t b) { return _mm_mul_ps(a, b); }
+static inline vfloat_t v_div(vfloat_t a, vfloat_t b) { return _mm_div_ps(a, b); }
+static inline vfloat_t v_zero_if_zero(vfloat_t v, vfloat_t d) {
+    return _mm_and_ps(v, _mm_cmpneq_ps(d, _mm_setzero_ps()));
+}
+static inline void v_store(float* p, vfloat_t v) { _mm_storeu_ps(p, v); }
+#elif !defined(TCS34725_BATCH_NO_SIMD) && defined(__ARM_NEON) && defined(__aarch64__)
+#include <arm_neon.h>
+#define SIMD_WIDTH 4
+typedef float32x4_t vfloat_t;
+static inline vfloat_t v_load_u16(const uint16_t* p) { return vcvtq_f32_u32(vmovl_u16(vld1_u16(p))); }
+static inline vfloat_t v_set(float f) { return vdupq_n_f32(f); }
+static inline vfloat_t v_add(vfloat_t a, vfloat_t b) { return vaddq_f32(a, b); }
+static inline vfloat_t v_mul(vfloat_t a, vfloat_t b) { return vmulq_f32(a, b); }
+static inline vfloat_t v_div(vfloat_t a, vfloat_t b) { return vdivq_f32(a, b); }
+static inline vfloat_t v_zero_if_zero(vfloat_t v, vfloat_t d) {
+    return vbslq_f32(vceqq_f32(d, vdupq_n_f32(0.0F)), vdupq_n_f32(0.0F), v);
+}
+static inline void v_store(float* p, vfloat_t v) { vst1q_f32(p, v); }
+#else
+#define SIMD_WIDTH 0
+#endif
+
+
+// Float to uint16_t with saturation (NaN maps to 0)
+static inline uint16_t saturate_u16(float v) {
+    return (v >= 65535.0F) ? 65535 : ((v > 0.0F) ? (uint16_t)v : 0);
+}
+
+
+void tcs34725_batch_normalized_RGB_soa(const tcs34725_color_soa_t* in, size_t n, float* restrict red, float* restrict green, float* restrict blue) {
+    const uint16_t* restrict r = in->red;
+    const uint16_t* restrict g = in->green;
+    const uint16_t* restrict b = in->blue;
+    const uint16_t* restrict c = in->clear;
+    size_t i = 0;
+
+#if SIMD_WIDTH
+    const vfloat_t scale = v_set(255.0F);
+    for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH){
+        vfloat_t sum = v_load_u16(&c[i]);
+        v_store(&red[i],   v_zero_if_zero(v_mul(v_div(v_load_u16(&r[i]), sum), scale), sum));
+        v_store(&green[i], v_zero_if_zero(v_mul(v_div(v_load_u16(&g[i]), sum), scale), sum));
+        v_store(&blue[i],  v_zero_if_zero(v_mul(v_div(v_load_u16(&b[i]), sum), scale), sum));
+    }
+#endif
+
+    /* The scalar version multiplies by 255.0 in double precision. The
+       product of a float and 255 is exact in double, so a float multiply
+       rounds to the same value */
+    for(; i < n; i++){
+        float sum = c[i];
+        red[i]   = (c[i] == 0) ? 0.0F : ((float)r[i] / sum) * 255.0F;
+        green[i] = (c[i] == 0) ? 0.0F : ((float)g[i] / sum) * 255.0F;
+        blue[i]  = (c[i] == 0) ? 0.0F : ((float)b[i] / sum) * 255.0F;
+    }
+}
+
+
+void tcs34725_batch_xyz_soa(const tcs34725_color_soa_t* in, size_t n, float* restrict X, float* restrict Y, float* restrict Z) {
+    const uint16_t* restrict r = in->red;
+    const uint16_t* restrict g = in->green;
+    const uint16_t* restrict b = in->blue;
+    size_t i = 0;
+
+#if SIMD_WIDTH
+    const vfloat_t xr = v_set(-0.14282F), xg = v_set(1.54924F), xb = v_set(-0.95641F);
+    const vfloat_t yr = v_set(-0.32466F), yg = v_set(1.57837F), yb = v_set(-0.73191F);
+    const vfloat_t zr = v_set(-0.68202F), zg = v_set(0.77073F), zb = v_set(0.56332F);
+    for(; i + SIMD_WIDTH <= n; i += SIMD_WIDTH){
+        vfloat_t vr = v_load_u16(&r[i]);
+        vfloat_t vg = v_load_u16(&g[i]);
+        vfloat_t vb = v_load_u16(&b[i]);
+        v_store(&X[i], v_add(v_add(v_mul(xr, vr), v_mul(xg, vg)), v_mul(xb, vb)));
+        v_store(&Y[i], v_add(v_add(v_mul(yr, vr), v_mul(yg, vg)), v_mul(yb, vb)));
+        v_store(&Z[i], v_add(v_add(v_mul(zr, vr), v_mul(zg, vg)), v_mul(zb, vb)));
+    }
+#endif
+
+    for(; i < n; i++){
+        X[i] = (-0.14282F * r[i]) + (1.54924F * g[i]) + (-0.95641F * b[i]);
+        Y[i] = (-0.32466F * r[i]) + (1.57837F * g[i]) + (-0.73191F * b[i]);
+        Z[i] = (-0.68202F * r[i]) + (0.77073F * g[i]) + (0.56332F * b[i]);
+    }
+}
+
+
+void tcs34725_batch_lux_soa(const tcs34725_color_soa_t* in, size_t n, uint16_t* restrict lux) {
+    const uint16_t* restrict r = in->red;
+    const uint16_t* restrict g = in->green;
+    const uint16_t* restrict b = in->blue;
+
+    for(size_t i = 0; i < n; i++){
+        float illuminance = (-0.32466F * r[i]) + (1.57837F * g[i]) + (-0.73191F * b[i]);
+        lux[i] = saturate_u16(illuminance);
+    }
+}
+
+
+void tcs34725_batch_color_temperature_soa(const tcs34725_color_soa_t* in, size_t n, uint16_t* restrict cct) {
+    const uint16_t* restrict r = in->red;
+    const uint16_t* restrict g = in->green;
+    const uint16_t* restrict b = in->blue;
+
+    // Branch free body so that the loop vectorizes, powf(n, k) is replaced by multiplications
+    for(size_t i = 0; i < n; i++){
+        float X = (-0.14282F * r[i]) + (1.54924F * g[i]) + (-0.95641F * b[i]);
+        float Y = (-0.32466F * r[i]) + (1.57837F * g[i]) + (-0.73191F * b[i]);
+        float Z = (-0.68202F * r[i]) + (0.77073F * g[i]) + (0.56332F * b[i]);
+        float xc = X / (X + Y + Z);
+        float yc = Y / (X + Y + Z);
+        float m = (xc - 0.3320F) / (0.1858F - yc);
+        float t = (449.0F * (m * m * m)) + (3525.0F * (m * m)) + (6823.3F * m) + 5520.33F;
+        bool dark = (r[i] == 0 && g[i] == 0 && b[i] == 0);
+        cct[i] = dark ? 0 : saturate_u16(t);
+    }
+}
+
+
+void tcs34725_batch_color_temperature_dn40_soa(const tcs34725_color_soa_t* in, size_t n, tcs34725_integration_time_t it, uint16_t* restrict cct) {
+    const uint16_t* restrict r = in->red;
+    const uint16_t* restrict g = in->green;
+    const uint16_t* restrict b = in->blue;
+    const uint16_t* restrict c = in->clear;
+
+    // Saturation only depends on the integration time, compute it once for the whole batch
+    uint16_t sat = tcs34725_calculate_saturation(it);
+
+    for(size_t i = 0; i < n; i++){
+        tcs34725_color_t color = {r[i], g[i], b[i], c[i]};
+        cct[i] = tcs34725_dn40(color, sat);
+    }
+}
+
+
+/* AoS entry points
+ *
+ * Samples are split into channel arrays on the stack, one chunk at a time,
+ * and handed to the SoA kernels.
+ */
+typedef struct {
+    uint16_t red[BATCH_CHUNK];
+    uint16_t green[BATCH_CHUNK];
+    uint16_t blue[BATCH_CHUNK];
+    uint16_t clear[BATCH_CHUNK];
+} soa_chunk_t;
+
+
+static size_t load_chunk(const tcs34725_color_t* colors, size_t n, soa_chunk_t* chunk, tcs34725_color_soa_t* soa) {
+    size_t count = (n < BATCH_CHUNK) ? n : BATCH_CHUNK;
+    for(size_t i = 0; i < count; i++){
+        chunk->red[i]   = colors[i].red;
+        chunk->green[i] = colors[i].green;
+        chunk->blue[i]  = colors[i].blue;
+        chunk->clear[i] = colors[i].clear;
+    }
+    soa->red = chunk->red;
+    soa->green = chunk->green;
+    soa->blue = chunk->blue;
+    soa->clear = chunk->clear;
+    return count;
+}
+
+
+void tcs34725_batch_normalized_RGB(const tcs34725_color_t* colors, size_t n, tcs34725_normalized_color_t* normalized) {
+    soa_chunk_t chunk;
+    tcs34725_color_soa_t soa;
+    float red[BATCH_CHUNK], green[BATCH_CHUNK], blue[BATCH_CHUNK];
+
+    for(size_t done = 0; done < n;){
+        size_t count = load_chunk(&colors[done], n - done, &chunk, &soa);
+        tcs34725_batch_normalized_RGB_soa(&soa, count, red, green, blue);
+        for(size_t i = 0; i < count; i++){
+            normalized[done + i].red = red[i];
+            normalized[done + i].green = green[i];
+            normalized[done + i].blue = blue[i];
+        }
+        done += count;
+    }
+}
+
+
+void tcs34725_batch_xyz(const tcs34725_color_t* colors, size_t n, tcs34725_xyz_t* xyz) {
+    soa_chunk_t chunk;
+    tcs34725_color_soa_t soa;
+    float X[BATCH_CHUNK], Y[BATCH_CHUNK], Z[BATCH_CHUNK];
+
+    for(size_t done = 0; done < n;){
+        size_t count = load_chunk(&colors[done], n - done, &chunk, &soa);
+        tcs34725_batch_xyz_soa(&soa, count, X, Y, Z);
+        for(size_t i = 0; i < count; i++){
+            xyz[done + i].X = X[i];
+            xyz[done + i].Y = Y[i];
+            xyz[done + i].Z = Z[i];
+        }
+        done += count;
+    }
+}
+
+
+void tcs34725_batch_lux(const tcs34725_color_t* colors, size_t n, uint16_t* lux) {
+    soa_chunk_t chunk;
+    tcs34725_color_soa_t soa;
+
+    for(size_t done = 0; done < n;){
+        size_t count = load_chunk(&colors[done], n - done, &chunk, &soa);
+        tcs34725_batch_lux_soa(&soa, count, &lux[done]);
+        done += count;
+    }
+}
+
+
+void tcs34725_batch_color_temperature(const tcs34725_color_t* colors, size_t n, uint16_t* cct) {
+    soa_chunk_t chunk;
+    tcs34725_color_soa_t soa;
+
+    for(size_t done = 0; done < n;){
+        size_t count = load_chunk(&colors[done], n - done, &chunk, &soa);
+        tcs34725_batch_color_temperature_soa(&soa, count, &cct[done]);
+        done += count;
+    }
+}
+
+
+void tcs34725_batch_color_temperature_dn40(const tcs34725_color_t* colors, size_t n, tcs34725_integration_time_t it, uint16_t* cct) {
+    soa_chunk_t chunk;
+    tcs34725_color_soa_t soa;
+
+    for(size_t done = 0; done < n;){
+        size_t count = load_chunk(&colors[done], n - done, &chunk, &soa);
+        tcs34725_batch_color_temperature_dn40_soa(&soa, count, it, &cct[done]);
+        done += count;
+    }
+}
@@ -0,0 +1,313 @@
+#include <string.h>
+#include "tcs34725_capture.h"
+
+#define FILE_MAGIC        "TCS1"
+#define BLOCK_MAGIC       "BLK1"
+// Largest encoded sample: timestamp delta (5) + status (1) + 4 channels (3 each)
+#define MAX_SAMPLE_SIZE   (18)
+
+static void put_u16(uint8_t*, uint16_t);
+static void put_u32(uint8_t*, uint32_t);
+static uint16_t get_u16(const uint8_t*);
+static uint32_t get_u32(const uint8_t*);
+static uint8_t* put_varint(uint8_t*, uint32_t);
+static bool get_varint(const uint8_t*, size_t*, size_t, uint32_t*);
+static void close_block(tcs34725_capture_writer_t*);
+static bool load_block(tcs34725_capture_iter_t*);
+static bool time_before(uint32_t, uint32_t);
+
+
+static void put_u16(uint8_t* p, uint16_t value) {
+    p[0] = (uint8_t)value;
+    p[1] = (uint8_t)(value >> 8);
+}
+
+
+static void put_u32(uint8_t* p, uint32_t value) {
+    put_u16(p, (uint16_t)value);
+    put_u16(p + 2, (uint16_t)(value >> 16));
+}
+
+
+static uint16_t get_u16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+
+static uint32_t get_u32(const uint8_t* p) {
+    return (uint32_t)get_u16(p) | ((uint32_t)get_u16(p + 2) << 16);
+}
+
+
+static uint8_t* put_varint(uint8_t* p, uint32_t value) {
+    // 7 bits per byte, least significant group first, MSB set on all but the last byte
+    while(value >= 0x80){
+        *p++ = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    *p++ = (uint8_t)value;
+    return p;
+}
+
+
+static bool get_varint(const uint8_t* data, size_t* pos, size_t end, uint32_t* value) {
+    uint32_t result = 0;
+    for(uint32_t shift = 0; shift < 35; shift += 7){
+        if(*pos >= end){
+            return false;
+        }
+        uint8_t byte = data[(*pos)++];
+        result |= (uint32_t)(byte & 0x7F) << shift;
+        if(!(byte & 0x80)){
+            *value = result;
+            return true;
+        }
+    }
+    return false;
+}
+
+
+static bool time_before(uint32_t a, uint32_t b) {
+    // Timestamps are a wrapping millisecond tick
+    return (int32_t)(a - b) < 0;
+}
+
+
+uint32_t tcs34725_capture_crc32(uint32_t crc, const uint8_t* data, size_t len) {
+    // Nibble table, 64 bytes instead of 1KB for the byte-wise version
+    static const uint32_t table[16] = {
+        0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+        0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+    };
+    crc = ~crc;
+    for(size_t i = 0; i < len; i++){
+        crc = table[(crc ^ data[i]) & 0x0F] ^ (crc >> 4);
+        crc = table[(crc ^ (data[i] >> 4)) & 0x0F] ^ (crc >> 4);
+    }
+    return ~crc;
+}
+
+
+tcs34725_err_t tcs34725_capture_writer_init(tcs34725_capture_writer_t* writer, uint8_t* buffer, size_t capacity, tcs34725_settings_t settings, uint8_t id) {
+    if(capacity < TCS34725_CAPTURE_HEADER_SIZE + TCS34725_CAPTURE_BLOCK_HEADER + MAX_SAMPLE_SIZE){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    writer->buffer = buffer;
+    writer->capacity = capacity;
+    writer->count = 0;
+
+    memcpy(buffer, FILE_MAGIC, 4);
+    buffer[4] = TCS34725_CAPTURE_VERSION;
+    buffer[5] = id;
+    buffer[6] = (uint8_t)settings.gain;
+    buffer[7] = (uint8_t)settings.integration_time;
+    put_u32(&buffer[8], tcs34725_capture_crc32(0, buffer, 8));
+    writer->length = TCS34725_CAPTURE_HEADER_SIZE;
+    return TCS34725_OK;
+}
+
+
+tcs34725_err_t tcs34725_capture_append(tcs34725_capture_writer_t* writer, const tcs34725_sample_t* sample) {
+    size_t needed = MAX_SAMPLE_SIZE + ((writer->count == 0) ? TCS34725_CAPTURE_BLOCK_HEADER : 0);
+    if(writer->length + needed > writer->capacity){
+        return TCS34725_ERR_WRITE;
+    }
+
+    if(writer->count == 0){
+        // The block header is filled in when the block is closed
+        writer->block = writer->length;
+        writer->length += TCS34725_CAPTURE_BLOCK_HEADER;
+        writer->first_time = sample->timestamp;
+        memset(&writer->last, 0, sizeof(writer->last));
+        writer->last.timestamp = sample->timestamp;
+    }
+
+    // Channel deltas are zigzag encoded so small changes of either sign stay small
+    int32_t delta[4] = {
+        (int32_t)sample->color.clear - (int32_t)writer->last.color.clear,
+        (int32_t)sample->color.red - (int32_t)writer->last.color.red,
+        (int32_t)sample->color.green - (int32_t)writer->last.color.green,
+        (int32_t)sample->color.blue - (int32_t)writer->last.color.blue,
+    };
+    uint8_t* p = &writer->buffer[writer->length];
+    p = put_varint(p, sample->timestamp - writer->last.timestamp);
+    *p++ = sample->status;
+    for(int i = 0; i < 4; i++){
+        p = put_varint(p, ((uint32_t)delta[i] << 1) ^ (uint32_t)(delta[i] >> 31));
+    }
+    writer->length = (size_t)(p - writer->buffer);
+    writer->last = *sample;
+    writer->count++;
+
+    if(writer->length - writer->block - TCS34725_CAPTURE_BLOCK_HEADER >= TCS34725_CAPTURE_BLOCK_PAYLOAD || writer->count == UINT16_MAX){
+        close_block(writer);
+    }
+    return TCS34725_OK;
+}
+
+
+static void close_block(tcs34725_capture_writer_t* writer) {
+    uint8_t* header = &writer->buffer[writer->block];
+    size_t payload = writer->length - writer->block - TCS34725_CAPTURE_BLOCK_HEADER;
+
+    memcpy(header, BLOCK_MAGIC, 4);
+    put_u16(&header[4], (uint16_t)payload);
+    put_u16(&header[6], writer->count);
+    put_u32(&header[8], writer->first_time);
+    put_u32(&header[12], writer->last.timestamp);
+    uint32_t crc = tcs34725_capture_crc32(0, &header[4], 12);
+    crc = tcs34725_capture_crc32(crc, &header[TCS34725_CAPTURE_BLOCK_HEADER], payload);
+    put_u32(&header[16], crc);
+    writer->count = 0;
+}
+
+
+void tcs34725_capture_flush(tcs34725_capture_writer_t* writer) {
+    if(writer->count > 0){
+        close_block(writer);
+    }
+}
+
+
+void tcs34725_capture_writer_restart(tcs34725_capture_writer_t* writer) {
+    writer->length = 0;
+    writer->count = 0;
+}
+
+
+tcs34725_err_t tcs34725_capture_reader_init(tcs34725_capture_reader_t* reader, const uint8_t* data, size_t size) {
+    if(size < TCS34725_CAPTURE_HEADER_SIZE || memcmp(data, FILE_MAGIC, 4) != 0 ||
+       data[4] != TCS34725_CAPTURE_VERSION || get_u32(&data[8]) != tcs34725_capture_crc32(0, data, 8)){
+        return TCS34725_ERR_READ;
+    }
+
+    reader->data = data;
+    reader->size = size;
+    reader->fd = -1;
+    reader->id = data[5];
+    reader->settings.gain = (tcs34725_gain_t)data[6];
+    reader->settings.integration_time = (tcs34725_integration_time_t)data[7];
+    return TCS34725_OK;
+}
+
+
+static bool load_block(tcs34725_capture_iter_t* iter) {
+    const uint8_t* data = iter->reader->data;
+    size_t size = iter->reader->size;
+    size_t block = iter->block;
+    bool lost = false;
+
+    while(block + TCS34725_CAPTURE_BLOCK_HEADER <= size){
+        if(memcmp(&data[block], BLOCK_MAGIC, 4) == 0){
+            size_t payload = get_u16(&data[block + 4]);
+            uint16_t count = get_u16(&data[block + 6]);
+            size_t end = block + TCS34725_CAPTURE_BLOCK_HEADER + payload;
+            if(end <= size && count > 0){
+                uint32_t crc = tcs34725_capture_crc32(0, &data[block + 4], 12);
+                crc = tcs34725_capture_crc32(crc, &data[block + TCS34725_CAPTURE_BLOCK_HEADER], payload);
+                if(crc == get_u32(&data[block + 16])){
+                    iter->bad_blocks += lost;
+                    iter->block = block;
+                    iter->pos = block + TCS34725_CAPTURE_BLOCK_HEADER;
+                    iter->end = end;
+                    iter->remaining = count;
+                    memset(&iter->last, 0, sizeof(iter->last));
+                    iter->last.timestamp = get_u32(&data[block + 8]);
+                    return true;
+                }
+            }
+        }
+        // Damaged (magic, header or payload) or truncated, resynchronize on the next block magic
+        lost = true;
+        block++;
+    }
+    // Bytes left over that do not form a block are a truncated tail
+    iter->bad_blocks += (lost || block < size);
+    iter->block = size;
+    iter->end = size;
+    return false;
+}
+
+
+void tcs34725_capture_begin(const tcs34725_capture_reader_t* reader, tcs34725_capture_iter_t* iter) {
+    memset(iter, 0, sizeof(*iter));
+    iter->reader = reader;
+    iter->block = TCS34725_CAPTURE_HEADER_SIZE;
+    iter->end = TCS34725_CAPTURE_HEADER_SIZE;
+}
+
+
+bool tcs34725_capture_next(tcs34725_capture_iter_t* iter, tcs34725_sample_t* sample) {
+    const uint8_t* data = iter->reader->data;
+
+    while(iter->remaining == 0){
+        iter->block = iter->end;
+        if(!load_block(iter)){
+            return false;
+        }
+    }
+
+    uint32_t dt = 0;
+    uint32_t zz[4];
+    bool ok = get_varint(data, &iter->pos, iter->end, &dt) && iter->pos < iter->end;
+    if(ok){
+        sample->status = data[iter->pos++];
+        for(int i = 0; i < 4 && ok; i++){
+            ok = get_varint(data, &iter->pos, iter->end, &zz[i]);
+        }
+    }
+    if(!ok){
+        // Count does not match the payload (only possible with a CRC collision)
+        iter->bad_blocks++;
+        iter->remaining = 0;
+        return tcs34725_capture_next(iter, sample);
+    }
+
+    uint16_t* channels[4] = {&sample->color.clear, &sample->color.red, &sample->color.green, &sample->color.blue};
+    const uint16_t* last[4] = {&iter->last.color.clear, &iter->last.color.red, &iter->last.color.green, &iter->last.color.blue};
+    for(int i = 0; i < 4; i++){
+        int32_t delta = (int32_t)(zz[i] >> 1) ^ -(int32_t)(zz[i] & 1);
+        *channels[i] = (uint16_t)(*last[i] + delta);
+    }
+    sample->timestamp = iter->last.timestamp + dt;
+
+    iter->last = *sample;
+    iter->remaining--;
+    return true;
+}
+
+
+void tcs34725_capture_seek(const tcs34725_capture_reader_t* reader, tcs34725_capture_iter_t* iter, uint32_t time) {
+    const uint8_t* data = reader->data;
+    tcs34725_capture_begin(reader, iter);
+
+    // Hop over whole blocks that end before time using only their headers
+    size_t block = TCS34725_CAPTURE_HEADER_SIZE;
+    while(block + TCS34725_CAPTURE_BLOCK_HEADER <= reader->size && memcmp(&data[block], BLOCK_MAGIC, 4) == 0){
+        size_t end = block + TCS34725_CAPTURE_BLOCK_HEADER + get_u16(&data[block + 4]);
+        if(end > reader->size || !time_before(get_u32(&data[block + 12]), time)){
+            break;
+        }
+        // A damaged length does not lead to the next header, decode (and resynchronize) from here
+        if(end + TCS34725_CAPTURE_BLOCK_HEADER <= reader->size && memcmp(&data[end], BLOCK_MAGIC, 4) != 0){
+            break;
+        }
+        block = end;
+    }
+    iter->block = block;
+    iter->end = block;
+
+    // Then decode up to the first sample at or after time
+    tcs34725_sample_t sample;
+    for(;;){
+        tcs34725_capture_iter_t save = *iter;
+        if(!tcs34725_capture_next(iter, &sample)){
+            break;
+        }
+        if(!time_before(sample.timestamp, time)){
+            *iter = save;
+            break;
+        }
+    }
+}
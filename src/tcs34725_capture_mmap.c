@@ -0,0 +1,45 @@
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "tcs34725_capture.h"
+
+
+tcs34725_err_t tcs34725_capture_open(tcs34725_capture_reader_t* reader, const char* path) {
+    tcs34725_err_t err;
+
+    int fd = open(path, O_RDONLY);
+    if(fd < 0){
+        return TCS34725_ERR_READ;
+    }
+
+    struct stat st;
+    void* data = MAP_FAILED;
+    if(fstat(fd, &st) == 0 && st.st_size > 0){
+        data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    }
+    if(data == MAP_FAILED){
+        close(fd);
+        return TCS34725_ERR_READ;
+    }
+
+    err = tcs34725_capture_reader_init(reader, (const uint8_t*)data, (size_t)st.st_size);
+    if(err != TCS34725_OK){
+        munmap(data, (size_t)st.st_size);
+        close(fd);
+    }else{
+        reader->fd = fd;
+    }
+    return err;
+}
+
+
+void tcs34725_capture_close(tcs34725_capture_reader_t* reader) {
+    if(reader->fd >= 0){
+        munmap((void*)reader->data, reader->size);
+        close(reader->fd);
+    }
+    reader->fd = -1;
+    reader->data = NULL;
+    reader->size = 0;
+}
@@ -0,0 +1,146 @@
+#include <math.h>
+#include "tcs34725_classify.h"
+
+#define GRID      TCS34725_CLASSIFY_GRID
+#define CELL_SIZE (1.0F / GRID)
+
+static float box_min_dist2(tcs34725_chromaticity_t, float, float);
+static float box_max_dist2(tcs34725_chromaticity_t, float, float);
+static uint32_t cell_of(tcs34725_chromaticity_t);
+
+
+static float box_min_dist2(tcs34725_chromaticity_t p, float r0, float g0) {
+    // Squared distance from p to the nearest point of the cell [r0, r0 + CELL_SIZE] x [g0, g0 + CELL_SIZE]
+    float dr = (p.r < r0) ? (r0 - p.r) : (p.r > r0 + CELL_SIZE) ? (p.r - r0 - CELL_SIZE) : 0.0F;
+    float dg = (p.g < g0) ? (g0 - p.g) : (p.g > g0 + CELL_SIZE) ? (p.g - g0 - CELL_SIZE) : 0.0F;
+    return dr * dr + dg * dg;
+}
+
+
+static float box_max_dist2(tcs34725_chromaticity_t p, float r0, float g0) {
+    // Squared distance from p to the furthest corner of the cell
+    float dr = fmaxf(fabsf(p.r - r0), fabsf(p.r - r0 - CELL_SIZE));
+    float dg = fmaxf(fabsf(p.g - g0), fabsf(p.g - g0 - CELL_SIZE));
+    return dr * dr + dg * dg;
+}
+
+
+static uint32_t cell_of(tcs34725_chromaticity_t p) {
+    int32_t x = (int32_t)(p.r * GRID);
+    int32_t y = (int32_t)(p.g * GRID);
+    x = (x < 0) ? 0 : (x >= GRID) ? GRID - 1 : x;
+    y = (y < 0) ? 0 : (y >= GRID) ? GRID - 1 : y;
+    return (uint32_t)(y * GRID + x);
+}
+
+
+tcs34725_chromaticity_t tcs34725_chromaticity(tcs34725_normalized_color_t color) {
+    tcs34725_chromaticity_t p;
+    float sum = color.red + color.green + color.blue;
+    if (sum <= 0.0F) {
+        p.r = 1.0F / 3.0F;
+        p.g = 1.0F / 3.0F;
+    } else {
+        p.r = color.red / sum;
+        p.g = color.green / sum;
+    }
+    return p;
+}
+
+
+tcs34725_err_t tcs34725_classify_init(tcs34725_classifier_t* classifier, const tcs34725_normalized_color_t* palette, uint16_t count,
+                                      tcs34725_chromaticity_t* points, uint16_t* candidates, size_t capacity, size_t* used, float reject) {
+    if(count == 0 || count == TCS34725_CLASSIFY_REJECT){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    for(uint16_t i = 0; i < count; i++){
+        points[i] = tcs34725_chromaticity(palette[i]);
+    }
+    classifier->points = points;
+    classifier->count = count;
+    classifier->reject = reject;
+    classifier->candidates = candidates;
+
+    size_t total = 0;
+    for(uint32_t cell = 0; cell < GRID * GRID; cell++){
+        float r0 = (float)(cell % GRID) * CELL_SIZE;
+        float g0 = (float)(cell / GRID) * CELL_SIZE;
+
+        /* For any point in the cell the nearest reference is at most the
+           smallest furthest-corner distance away, and the second nearest
+           at most the second smallest. References whose nearest-corner
+           distance exceeds the latter can never be first or second */
+        float best = INFINITY, second = INFINITY;
+        for(uint16_t i = 0; i < count; i++){
+            float d = box_max_dist2(points[i], r0, g0);
+            if(d < best){
+                second = best;
+                best = d;
+            }else if(d < second){
+                second = d;
+            }
+        }
+        if(count == 1){
+            second = best;
+        }
+
+        classifier->cells[cell] = (uint16_t)((total <= UINT16_MAX) ? total : UINT16_MAX);
+        for(uint16_t i = 0; i < count; i++){
+            if(box_min_dist2(points[i], r0, g0) <= second){
+                if(total < capacity){
+                    candidates[total] = i;
+                }
+                total++;
+            }
+        }
+    }
+    classifier->cells[GRID * GRID] = (uint16_t)((total <= UINT16_MAX) ? total : UINT16_MAX);
+
+    if(used != NULL){
+        *used = total;
+    }
+    return (total <= capacity && total <= UINT16_MAX) ? TCS34725_OK : TCS34725_ERR_INVALID_ARG;
+}
+
+
+tcs34725_classification_t tcs34725_classify(const tcs34725_classifier_t* classifier, tcs34725_normalized_color_t color) {
+    tcs34725_chromaticity_t p = tcs34725_chromaticity(color);
+    uint32_t cell = cell_of(p);
+
+    uint16_t index = TCS34725_CLASSIFY_REJECT;
+    float best = INFINITY, second = INFINITY;
+    for(uint32_t i = classifier->cells[cell]; i < classifier->cells[cell + 1]; i++){
+        uint16_t candidate = classifier->candidates[i];
+        float dr = p.r - classifier->points[candidate].r;
+        float dg = p.g - classifier->points[candidate].g;
+        float d = dr * dr + dg * dg;
+        if(d < best){
+            second = best;
+            best = d;
+            index = candidate;
+        }else if(d < second){
+            second = d;
+        }
+    }
+
+    tcs34725_classification_t result;
+    result.distance = sqrtf(best);
+    if(second == INFINITY){
+        result.confidence = 1.0F;
+    }else if(second > 0.0F){
+        result.confidence = 1.0F - result.distance / sqrtf(second);
+    }else{
+        // Two references at the same chromaticity
+        result.confidence = 0.0F;
+    }
+    result.index = (classifier->reject > 0.0F && result.distance > classifier->reject) ? TCS34725_CLASSIFY_REJECT : index;
+    return result;
+}
+
+
+void tcs34725_classify_batch(const tcs34725_classifier_t* classifier, const tcs34725_normalized_color_t* colors, size_t n, tcs34725_classification_t* results) {
+    for(size_t i = 0; i < n; i++){
+        results[i] = tcs34725_classify(classifier, colors[i]);
+    }
+}
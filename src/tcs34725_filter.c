@@ -0,0 +1,91 @@
+#include "tcs34725.h"
+#include "tcs34725_filter.h"
+
+
+tcs34725_err_t tcs34725_filter_init(tcs34725_filter_t* filter, tcs34725_integration_time_t it, uint16_t window_ms, uint8_t decimation, uint8_t iir_shift) {
+    if(decimation == 0 || iir_shift > 16){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    // Integration period in tenths of a millisecond, round the window to whole samples
+    uint32_t period = (256 - (uint32_t)it) * 24;
+    uint32_t length = ((uint32_t)window_ms * 10 + period / 2) / period;
+    if(length == 0){
+        length = 1;
+    }else if(length > TCS34725_FILTER_MAX_TAPS){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    filter->length = (uint8_t)length;
+    filter->decimation = decimation;
+    filter->iir_shift = iir_shift;
+    filter->saturation = tcs34725_calculate_saturation(it);
+    filter->rejected = 0;
+    tcs34725_filter_reset(filter);
+    return TCS34725_OK;
+}
+
+
+void tcs34725_filter_reset(tcs34725_filter_t* filter) {
+    for(int i = 0; i < 4; i++){
+        filter->sum[i] = 0;
+    }
+    filter->count = 0;
+    filter->index = 0;
+    filter->phase = 0;
+    filter->iir_valid = false;
+}
+
+
+bool tcs34725_filter_push(tcs34725_filter_t* filter, tcs34725_color_t sample, tcs34725_color_t* out) {
+    if(sample.clear >= filter->saturation){
+        // The window has to cover consecutive samples, start over after the gap
+        filter->rejected++;
+        tcs34725_filter_reset(filter);
+        return false;
+    }
+
+    // Moving sum: add the new sample, drop the one leaving the window
+    tcs34725_color_t* tap = &filter->taps[filter->index];
+    if(filter->count == filter->length){
+        filter->sum[0] -= tap->red;
+        filter->sum[1] -= tap->green;
+        filter->sum[2] -= tap->blue;
+        filter->sum[3] -= tap->clear;
+    }else{
+        filter->count++;
+    }
+    *tap = sample;
+    filter->sum[0] += sample.red;
+    filter->sum[1] += sample.green;
+    filter->sum[2] += sample.blue;
+    filter->sum[3] += sample.clear;
+    filter->index = (uint8_t)((filter->index + 1) % filter->length);
+
+    if(++filter->phase < filter->decimation){
+        return false;
+    }
+    filter->phase = 0;
+    if(filter->count < filter->length){
+        // Window not covered yet, the average would still contain ripple
+        return false;
+    }
+
+    uint16_t* channels[4] = {&out->red, &out->green, &out->blue, &out->clear};
+    for(int i = 0; i < 4; i++){
+        uint32_t average = (filter->sum[i] + filter->length / 2) / filter->length;
+        if(filter->iir_shift > 0){
+            // y += (x - y) * 2^-shift, state in 8 fractional bits
+            if(!filter->iir_valid){
+                filter->iir[i] = average << 8;
+            }else{
+                int32_t delta = (int32_t)(average << 8) - (int32_t)filter->iir[i];
+                filter->iir[i] = (uint32_t)((int32_t)filter->iir[i] + delta / (1 << filter->iir_shift));
+            }
+            average = (filter->iir[i] + 128) >> 8;
+        }
+        *channels[i] = (uint16_t)average;
+    }
+    filter->iir_valid = true;
+    return true;
+}
@@ -0,0 +1,305 @@
+#define _POSIX_C_SOURCE 200112L
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include "tcs34725.h"
+#include "tcs34725_linux_i2c.h"
+
+static uint8_t command_byte(uint8_t);
+static uint8_t command_offset(uint8_t, uint32_t);
+static int do_ioctl(tcs34725_linux_i2c_t*, unsigned long, void*);
+static int8_t flush(tcs34725_linux_i2c_t*);
+static int8_t queue_write(tcs34725_linux_i2c_t*, uint8_t, const uint8_t*, uint32_t);
+static int8_t smbus_transfer(tcs34725_linux_i2c_t*, uint8_t, uint8_t, uint32_t, union i2c_smbus_data*);
+static int8_t pending_error(tcs34725_linux_i2c_t*);
+
+// Device whose queued writes are sent by delay_ms (between begin and end)
+static tcs34725_linux_i2c_t* batching_dev = NULL;
+
+
+static uint8_t command_byte(uint8_t reg_addr) {
+    // Bare register addresses use the auto-increment protocol, complete command bytes are sent as is
+    if(reg_addr & (TCS34725_COMMAND_BIT << 7)){
+        return reg_addr;
+    }
+    return TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_INCREMENT_ADDR, reg_addr);
+}
+
+
+static uint8_t command_offset(uint8_t command, uint32_t offset) {
+    // Command byte addressing the register offset bytes further (only moves with auto-increment)
+    if(((command >> 5) & 0b11) != TCS34725_INCREMENT_ADDR){
+        return command;
+    }
+    return (uint8_t)((command & ~0b00011111) | ((command + offset) & 0b00011111));
+}
+
+
+static int do_ioctl(tcs34725_linux_i2c_t* dev, unsigned long request, void* arg) {
+    dev->syscalls++;
+    if(dev->ioctl_fn != NULL){
+        return dev->ioctl_fn(dev->fd, request, arg);
+    }
+    return ioctl(dev->fd, request, arg);
+}
+
+
+static int8_t flush(tcs34725_linux_i2c_t* dev) {
+    if(dev->msg_count == 0){
+        return 0;
+    }
+
+    struct i2c_rdwr_ioctl_data rdwr = {
+        .msgs = dev->msgs,
+        .nmsgs = dev->msg_count,
+    };
+    int ret = do_ioctl(dev, I2C_RDWR, &rdwr);
+    if(ret < 0 && dev->config != NULL){
+        // Queued writes may or may not have reached the device
+        tcs34725_invalidate_cache(dev->config);
+    }
+    dev->msg_count = 0;
+    dev->tx_used = 0;
+    return (ret < 0) ? -1 : 0;
+}
+
+
+static int8_t pending_error(tcs34725_linux_i2c_t* dev) {
+    // Report a failure of writes sent by delay_ms once
+    if(dev->write_error){
+        dev->write_error = false;
+        return -1;
+    }
+    return 0;
+}
+
+
+static int8_t queue_write(tcs34725_linux_i2c_t* dev, uint8_t command, const uint8_t* data, uint32_t len) {
+    if(1 + len > TCS34725_LINUX_I2C_TX_SIZE){
+        return -1;
+    }
+    // Make room, this sends the writes queued so far
+    if(dev->msg_count >= TCS34725_LINUX_I2C_MAX_MSGS || dev->tx_used + 1 + len > TCS34725_LINUX_I2C_TX_SIZE){
+        if(flush(dev) != 0){
+            return -1;
+        }
+    }
+
+    uint8_t* buf = &dev->tx[dev->tx_used];
+    buf[0] = command;
+    if(len > 0){
+        memcpy(&buf[1], data, len);
+    }
+    dev->tx_used += 1 + len;
+    dev->msgs[dev->msg_count++] = (struct i2c_msg){
+        .addr = dev->address,
+        .flags = 0,
+        .len = (uint16_t)(1 + len),
+        .buf = buf,
+    };
+
+    return dev->batching ? 0 : flush(dev);
+}
+
+
+static int8_t smbus_transfer(tcs34725_linux_i2c_t* dev, uint8_t read_write, uint8_t command, uint32_t size, union i2c_smbus_data* data) {
+    struct i2c_smbus_ioctl_data args = {
+        .read_write = read_write,
+        .command = command,
+        .size = size,
+        .data = data,
+    };
+    return (do_ioctl(dev, I2C_SMBUS, &args) < 0) ? -1 : 0;
+}
+
+
+tcs34725_err_t tcs34725_linux_i2c_open(tcs34725_linux_i2c_t* dev, const char* path, uint16_t address) {
+    tcs34725_ioctl_fptr_t ioctl_fn = dev->ioctl_fn;
+    memset(dev, 0, sizeof(*dev));
+    dev->ioctl_fn = ioctl_fn;
+    dev->address = address;
+
+    dev->fd = open(path, O_RDWR);
+    if(dev->fd < 0){
+        return TCS34725_ERR_DEVICE_NOT_FOUND;
+    }
+
+    unsigned long funcs = 0;
+    if(do_ioctl(dev, I2C_FUNCS, &funcs) < 0){
+        tcs34725_linux_i2c_close(dev);
+        return TCS34725_ERR_DEVICE_NOT_FOUND;
+    }
+    if(!(funcs & I2C_FUNC_I2C)){
+        // SMBus transfers go to the address selected with I2C_SLAVE
+        if((funcs & I2C_FUNC_SMBUS_I2C_BLOCK) != I2C_FUNC_SMBUS_I2C_BLOCK ||
+           do_ioctl(dev, I2C_SLAVE, (void*)(unsigned long)address) < 0){
+            tcs34725_linux_i2c_close(dev);
+            return TCS34725_ERR_DEVICE_NOT_FOUND;
+        }
+        dev->smbus = true;
+    }
+    return TCS34725_OK;
+}
+
+
+void tcs34725_linux_i2c_close(tcs34725_linux_i2c_t* dev) {
+    if(batching_dev == dev){
+        batching_dev = NULL;
+    }
+    if(dev->fd >= 0){
+        close(dev->fd);
+    }
+    dev->fd = -1;
+}
+
+
+void tcs34725_linux_i2c_attach(tcs34725_linux_i2c_t* dev, tcs34725_config_t* config) {
+    dev->config = config;
+    config->user_ptr = dev;
+    config->read_reg = tcs34725_linux_i2c_read_reg;
+    config->write_reg = tcs34725_linux_i2c_write_reg;
+    config->write_byte = tcs34725_linux_i2c_write_byte;
+    config->delay_ms = tcs34725_linux_i2c_delay_ms;
+    config->get_tick_ms = tcs34725_linux_i2c_get_tick_ms;
+}
+
+
+void tcs34725_linux_i2c_begin(tcs34725_linux_i2c_t* dev) {
+    // Ignored on SMBus adapters, every operation is its own transfer there
+    if(dev->smbus){
+        return;
+    }
+    // delay_ms can only flush one device, a previous batch is ended here
+    if(batching_dev != NULL && batching_dev != dev){
+        batching_dev->batching = false;
+        batching_dev->write_error |= (flush(batching_dev) != 0);
+    }
+    dev->batching = true;
+    batching_dev = dev;
+}
+
+
+int8_t tcs34725_linux_i2c_end(tcs34725_linux_i2c_t* dev) {
+    dev->batching = false;
+    if(batching_dev == dev){
+        batching_dev = NULL;
+    }
+    int8_t ret = flush(dev);
+    return (pending_error(dev) != 0) ? -1 : ret;
+}
+
+
+int8_t tcs34725_linux_i2c_read_reg(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    tcs34725_linux_i2c_t* dev = (tcs34725_linux_i2c_t*)user_ptr;
+    uint8_t command = command_byte(reg_addr);
+
+    if(pending_error(dev) != 0){
+        return -1;
+    }
+
+    if(dev->smbus){
+        // I2C block transfers are limited to 32 bytes
+        for(uint32_t offset = 0; offset < len; offset += I2C_SMBUS_BLOCK_MAX){
+            uint32_t chunk = (len - offset < I2C_SMBUS_BLOCK_MAX) ? (len - offset) : I2C_SMBUS_BLOCK_MAX;
+            union i2c_smbus_data data;
+            data.block[0] = (uint8_t)chunk;
+            if(smbus_transfer(dev, I2C_SMBUS_READ, command_offset(command, offset), I2C_SMBUS_I2C_BLOCK_DATA, &data) != 0){
+                return -1;
+            }
+            memcpy(&reg_data[offset], &data.block[1], chunk);
+        }
+        return 0;
+    }
+
+    if(len > UINT16_MAX){
+        return -1;
+    }
+
+    /* Command byte write and data read in one combined transaction,
+       queued writes (if any) go out in the same ioctl */
+    if(dev->msg_count + 2 > TCS34725_LINUX_I2C_MAX_MSGS || dev->tx_used + 1 > TCS34725_LINUX_I2C_TX_SIZE){
+        if(flush(dev) != 0){
+            return -1;
+        }
+    }
+    uint8_t* buf = &dev->tx[dev->tx_used++];
+    *buf = command;
+    dev->msgs[dev->msg_count++] = (struct i2c_msg){
+        .addr = dev->address,
+        .flags = 0,
+        .len = 1,
+        .buf = buf,
+    };
+    dev->msgs[dev->msg_count++] = (struct i2c_msg){
+        .addr = dev->address,
+        .flags = I2C_M_RD,
+        .len = (uint16_t)len,
+        .buf = reg_data,
+    };
+    return flush(dev);
+}
+
+
+int8_t tcs34725_linux_i2c_write_reg(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    tcs34725_linux_i2c_t* dev = (tcs34725_linux_i2c_t*)user_ptr;
+    uint8_t command = command_byte(reg_addr);
+
+    if(pending_error(dev) != 0){
+        return -1;
+    }
+
+    if(dev->smbus){
+        for(uint32_t offset = 0; offset < len; offset += I2C_SMBUS_BLOCK_MAX){
+            uint32_t chunk = (len - offset < I2C_SMBUS_BLOCK_MAX) ? (len - offset) : I2C_SMBUS_BLOCK_MAX;
+            union i2c_smbus_data data;
+            data.block[0] = (uint8_t)chunk;
+            memcpy(&data.block[1], &reg_data[offset], chunk);
+            if(smbus_transfer(dev, I2C_SMBUS_WRITE, command_offset(command, offset), I2C_SMBUS_I2C_BLOCK_DATA, &data) != 0){
+                return -1;
+            }
+        }
+        return 0;
+    }
+    return queue_write(dev, command, reg_data, len);
+}
+
+
+int8_t tcs34725_linux_i2c_write_byte(uint8_t single_byte, void* user_ptr) {
+    tcs34725_linux_i2c_t* dev = (tcs34725_linux_i2c_t*)user_ptr;
+
+    if(pending_error(dev) != 0){
+        return -1;
+    }
+
+    if(dev->smbus){
+        return smbus_transfer(dev, I2C_SMBUS_WRITE, single_byte, I2C_SMBUS_BYTE, NULL);
+    }
+    return queue_write(dev, single_byte, NULL, 0);
+}
+
+
+void tcs34725_linux_i2c_delay_ms(uint32_t period) {
+    // Queued writes go out before the delay, the driver relies on it for the PON to AEN warm-up
+    if(batching_dev != NULL && flush(batching_dev) != 0){
+        batching_dev->write_error = true;
+    }
+
+    struct timespec ts = {
+        .tv_sec = period / 1000,
+        .tv_nsec = (long)(period % 1000) * 1000000L,
+    };
+    while(clock_nanosleep(CLOCK_MONOTONIC, 0, &ts, &ts) == EINTR){
+        // Interrupted by a signal, sleep for the remaining time
+    }
+}
+
+
+uint32_t tcs34725_linux_i2c_get_tick_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000);
+}
@@ -0,0 +1,115 @@
+#include "tcs34725.h"
+#include "tcs34725_plan.h"
+
+// RGB to XYZ rows of tcs34725_calculate_color_temperature
+static const float xyz[3][3] = {
+    {-0.14282F, 1.54924F, -0.95641F},
+    {-0.32466F, 1.57837F, -0.73191F},
+    {-0.68202F, 0.77073F,  0.56332F},
+};
+
+static void fold(const float*, const float*, float*);
+static float mccamy(float);
+static uint16_t saturate(float);
+
+
+static void fold(const float* row, const float* calibration, float* out) {
+    // row . (M * rgb) = (row * M) . rgb
+    for(int j = 0; j < 3; j++){
+        if(calibration == NULL){
+            out[j] = row[j];
+        }else{
+            out[j] = row[0] * calibration[0 * 3 + j] + row[1] * calibration[1 * 3 + j] + row[2] * calibration[2 * 3 + j];
+        }
+    }
+}
+
+
+static float mccamy(float n) {
+    return ((449.0F * n + 3525.0F) * n + 6823.3F) * n + 5520.33F;
+}
+
+
+static uint16_t saturate(float value) {
+    if(!(value > 0.0F)){
+        return 0;
+    }else if(value >= 65535.0F){
+        return 65535;
+    }
+    return (uint16_t)value;
+}
+
+
+tcs34725_err_t tcs34725_plan_init(tcs34725_plan_t* plan, tcs34725_settings_t settings, const float* calibration, uint16_t* table, uint16_t table_size) {
+    if(table != NULL && table_size < 2){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    plan->settings = settings;
+    plan->saturation = tcs34725_calculate_saturation(settings.integration_time);
+
+    /* xc = X / S and yc = Y / S with S = X + Y + Z, so McCamy's
+       n = (xc - 0.3320) / (0.1858 - yc) = (X - 0.3320 S) / (0.1858 S - Y).
+       Numerator and denominator are linear in RGB, fold them into rows */
+    float num[3], den[3];
+    for(int j = 0; j < 3; j++){
+        float sum = xyz[0][j] + xyz[1][j] + xyz[2][j];
+        num[j] = xyz[0][j] - 0.3320F * sum;
+        den[j] = 0.1858F * sum - xyz[1][j];
+    }
+    fold(num, calibration, plan->num);
+    fold(den, calibration, plan->den);
+    fold(xyz[1], calibration, plan->lux);
+
+    plan->cct_table = (table_size > 0) ? table : NULL;
+    plan->cct_size = (table != NULL) ? table_size : 0;
+    plan->n_scale = (float)(plan->cct_size - 1) / (TCS34725_PLAN_N_MAX - TCS34725_PLAN_N_MIN);
+    for(uint16_t i = 0; i < plan->cct_size; i++){
+        table[i] = saturate(mccamy(TCS34725_PLAN_N_MIN + (float)i / plan->n_scale));
+    }
+    return TCS34725_OK;
+}
+
+
+uint16_t tcs34725_plan_color_temperature(const tcs34725_plan_t* plan, tcs34725_color_t color) {
+    if (color.red == 0 && color.green == 0 && color.blue == 0) {
+        return 0;
+    }
+
+    float r = color.red, g = color.green, b = color.blue;
+    float num = plan->num[0] * r + plan->num[1] * g + plan->num[2] * b;
+    float den = plan->den[0] * r + plan->den[1] * g + plan->den[2] * b;
+    if (den == 0.0F) {
+        return 0;
+    }
+    float n = num / den;
+
+    // Table lookup with linear interpolation, the cubic outside of the table
+    float pos = (n - TCS34725_PLAN_N_MIN) * plan->n_scale;
+    if (plan->cct_table != NULL && pos >= 0.0F && pos < (float)(plan->cct_size - 1)) {
+        uint32_t i = (uint32_t)pos;
+        float frac = pos - (float)i;
+        float lo = plan->cct_table[i];
+        float hi = plan->cct_table[i + 1];
+        return saturate(lo + (hi - lo) * frac);
+    }
+    return saturate(mccamy(n));
+}
+
+
+uint16_t tcs34725_plan_color_temperature_dn40(const tcs34725_plan_t* plan, tcs34725_color_t color) {
+    /* Same as tcs34725_calculate_color_temperature_dn40 with the saturation
+       threshold from the plan. The calibration matrix is not applied, the
+       DN40 coefficients are fitted to the raw (uncalibrated) channel counts */
+    return tcs34725_dn40(color, plan->saturation);
+}
+
+
+uint16_t tcs34725_plan_lux(const tcs34725_plan_t* plan, tcs34725_color_t color) {
+    return saturate(plan->lux[0] * color.red + plan->lux[1] * color.green + plan->lux[2] * color.blue);
+}
+
+
+bool tcs34725_plan_saturated(const tcs34725_plan_t* plan, tcs34725_color_t color) {
+    return color.clear >= plan->saturation;
+}
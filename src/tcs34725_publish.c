@@ -0,0 +1,74 @@
+#include "tcs34725.h"
+#include "tcs34725_publish.h"
+
+
+void tcs34725_publish(tcs34725_publisher_t* pub, const tcs34725_snapshot_t* snapshot) {
+    uint_least32_t seq = atomic_load_explicit(&pub->seq, memory_order_relaxed);
+
+    /* Readers that see an odd counter, or a different counter after their
+       copy, retry. The release fence keeps the data stores below from
+       becoming visible before the odd counter */
+    atomic_store_explicit(&pub->seq, seq + 1, memory_order_relaxed);
+    atomic_thread_fence(memory_order_release);
+
+    atomic_store_explicit(&pub->words[0], (uint_least32_t)snapshot->color.red | ((uint_least32_t)snapshot->color.green << 16), memory_order_relaxed);
+    atomic_store_explicit(&pub->words[1], (uint_least32_t)snapshot->color.blue | ((uint_least32_t)snapshot->color.clear << 16), memory_order_relaxed);
+    atomic_store_explicit(&pub->words[2], (uint_least32_t)snapshot->lux | ((uint_least32_t)snapshot->color_temperature << 16), memory_order_relaxed);
+    atomic_store_explicit(&pub->words[3], (uint_least32_t)snapshot->timestamp, memory_order_relaxed);
+
+    atomic_store_explicit(&pub->seq, seq + 2, memory_order_release);
+}
+
+
+tcs34725_err_t tcs34725_publish_step(tcs34725_publisher_t* pub, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+    bool ready = false;
+
+    // Continuous and event mode never become ready through tcs34725_poll
+    if(config->state.acquisition == TCS34725_STATE_CONTINUOUS || config->state.acquisition == TCS34725_STATE_EVENT){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    if(config->state.acquisition == TCS34725_STATE_IDLE){
+        err |= tcs34725_start(config);
+    }
+
+    // Sleep until the sample is due, the bus is only touched for the warm-up and the final read
+    while(!ready){
+        uint32_t wait = tcs34725_next_poll_ms(config);
+        if(wait > 0){
+            config->delay_ms(wait);
+            continue;
+        }
+        err |= tcs34725_poll(&ready, config);
+        if(err != TCS34725_OK){
+            return err;
+        }
+        if(!ready){
+            // Integration period elapsed but AVALID is not set yet
+            config->delay_ms(1);
+        }
+    }
+
+    tcs34725_snapshot_t snapshot;
+    err |= tcs34725_fetch(&snapshot.color, config);
+    snapshot.timestamp = config->get_tick_ms();
+    snapshot.lux = tcs34725_calculate_lux(snapshot.color);
+    snapshot.color_temperature = tcs34725_calculate_color_temperature_dn40(snapshot.color, config);
+    tcs34725_publish(pub, &snapshot);
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_publish_run(tcs34725_publisher_t* pub, const atomic_bool* stop, tcs34725_config_t* config) {
+    tcs34725_err_t err = TCS34725_OK;
+
+    while(!atomic_load_explicit(stop, memory_order_relaxed)){
+        err = tcs34725_publish_step(pub, config);
+        if(err != TCS34725_OK){
+            break;
+        }
+    }
+    err |= tcs34725_disable(config);
+    return err;
+}
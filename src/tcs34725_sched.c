@@ -0,0 +1,158 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include "tcs34725.h"
+#include "tcs34725_sched.h"
+
+// Margin (in ms) on top of two integration periods before a sensor is given up on
+#define SCHED_TIMEOUT_MARGIN_MS (20)
+
+static tcs34725_err_t select_sensor(tcs34725_sched_t*, const tcs34725_sched_sensor_t*);
+static bool sensor_before(const tcs34725_sched_sensor_t*, const tcs34725_sched_sensor_t*);
+
+
+static bool sensor_before(const tcs34725_sched_sensor_t* a, const tcs34725_sched_sensor_t* b) {
+    return (a->bus < b->bus) || (a->bus == b->bus && a->channel < b->channel);
+}
+
+
+tcs34725_err_t tcs34725_sched_init(tcs34725_sched_t* sched) {
+    if(sched->order == NULL || sched->delay_ms == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    // Insertion sort by (bus, channel), sensor lists are short
+    for(size_t i = 0; i < sched->sensor_count; i++){
+        const tcs34725_sched_sensor_t* sensor = &sched->sensors[i];
+        if(sensor->bus >= sched->bus_count || sensor->config->get_tick_ms == NULL){
+            return TCS34725_ERR_INVALID_ARG;
+        }
+        size_t j = i;
+        while(j > 0 && sensor_before(sensor, &sched->sensors[sched->order[j - 1]])){
+            sched->order[j] = sched->order[j - 1];
+            j--;
+        }
+        sched->order[j] = (uint16_t)i;
+    }
+
+    for(size_t i = 0; i < sched->bus_count; i++){
+        sched->buses[i].channel = -1;
+    }
+    sched->mux_switches = 0;
+    return TCS34725_OK;
+}
+
+
+static tcs34725_err_t select_sensor(tcs34725_sched_t* sched, const tcs34725_sched_sensor_t* sensor) {
+    tcs34725_bus_t* bus = &sched->buses[sensor->bus];
+    if(bus->select == NULL || bus->channel == sensor->channel){
+        return TCS34725_OK;
+    }
+
+    sched->mux_switches++;
+    if(bus->select(sensor->channel, bus->user_ptr) != 0){
+        bus->channel = -1;
+        return TCS34725_ERR_WRITE;
+    }
+    bus->channel = sensor->channel;
+    return TCS34725_OK;
+}
+
+
+tcs34725_err_t tcs34725_sched_run(tcs34725_sched_t* sched) {
+    tcs34725_err_t err = TCS34725_OK;
+    size_t pending = 0;
+
+    if(sched->sensor_count == 0){
+        return TCS34725_OK;
+    }
+
+    /* 1. Start every sensor that is not already integrating. Starting in
+          service order staggers the integrations by one bus transaction,
+          so they complete in the same order they will be fetched in */
+    for(size_t i = 0; i < sched->sensor_count; i++){
+        tcs34725_sched_sensor_t* sensor = &sched->sensors[sched->order[i]];
+        tcs34725_config_t* config = sensor->config;
+        sensor->err = TCS34725_OK;
+        if(!sched->free_running || config->state.acquisition == TCS34725_STATE_IDLE){
+            sensor->err |= select_sensor(sched, sensor);
+            if(sensor->err == TCS34725_OK){
+                sensor->err |= tcs34725_start(config);
+            }
+        }
+        sensor->pending = (sensor->err == TCS34725_OK);
+        if(sensor->pending){
+            pending++;
+        }
+    }
+
+    /* 2. Service whichever sensor has bus work due (AEN after the warm-up,
+          status/data once the integration is over), sleep otherwise */
+    uint32_t start = sched->sensors[sched->order[0]].config->get_tick_ms();
+    uint32_t timeout = 0;
+    for(size_t i = 0; i < sched->sensor_count; i++){
+        tcs34725_integration_time_t it = sched->sensors[i].config->settings.integration_time;
+        uint32_t limit = 3 + 2 * (((256 - (uint32_t)it) * 24 + 9) / 10) + SCHED_TIMEOUT_MARGIN_MS;
+        if(limit > timeout){
+            timeout = limit;
+        }
+    }
+
+    while(pending > 0){
+        uint32_t wait = UINT32_MAX;
+        for(size_t i = 0; i < sched->sensor_count; i++){
+            tcs34725_sched_sensor_t* sensor = &sched->sensors[sched->order[i]];
+            if(!sensor->pending){
+                continue;
+            }
+            uint32_t due = tcs34725_next_poll_ms(sensor->config);
+            if(due > 0){
+                wait = (due < wait) ? due : wait;
+                continue;
+            }
+
+            bool ready = false;
+            sensor->err |= select_sensor(sched, sensor);
+            if(sensor->err == TCS34725_OK){
+                sensor->err |= tcs34725_poll(&ready, sensor->config);
+            }
+            if(ready){
+                sensor->err |= tcs34725_fetch(&sensor->color, sensor->config);
+            }
+            if(ready || sensor->err != TCS34725_OK){
+                sensor->pending = false;
+                pending--;
+            }else{
+                // AVALID not set yet, try again shortly
+                wait = (wait > 1) ? 1 : wait;
+            }
+        }
+
+        if(pending > 0 && wait != UINT32_MAX && wait > 0){
+            uint32_t elapsed = sched->sensors[sched->order[0]].config->get_tick_ms() - start;
+            if(elapsed > timeout){
+                break;
+            }
+            sched->delay_ms(wait);
+        }
+    }
+
+    // 3. Sensors that did not deliver, and power down unless free running
+    for(size_t i = 0; i < sched->sensor_count; i++){
+        tcs34725_sched_sensor_t* sensor = &sched->sensors[sched->order[i]];
+        if(sensor->pending){
+            sensor->pending = false;
+            sensor->err = TCS34725_ERR_NOT_READY;
+        }
+        if(!sched->free_running){
+            // Without the right mux channel the disable would reach another sensor
+            tcs34725_err_t select_err = select_sensor(sched, sensor);
+            if(select_err == TCS34725_OK){
+                sensor->err |= tcs34725_disable(sensor->config);
+            }else{
+                sensor->err |= select_err;
+            }
+        }
+        err |= sensor->err;
+    }
+    return err;
+}
@@ -0,0 +1,264 @@
+#include <string.h>
+#include "tcs34725.h"
+#include "tcs34725_script.h"
+
+static uint8_t command(uint8_t);
+static tcs34725_step_t* add_step(tcs34725_script_t*, tcs34725_step_type_t);
+static void fix_byte_order(const tcs34725_segment_t*);
+static void track_write(tcs34725_config_t*, uint8_t, const uint8_t*, uint8_t, bool);
+
+
+static uint8_t command(uint8_t reg) {
+    return TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_INCREMENT_ADDR, reg);
+}
+
+
+static tcs34725_step_t* add_step(tcs34725_script_t* script, tcs34725_step_type_t type) {
+    if(script->step_count >= TCS34725_SCRIPT_MAX_STEPS){
+        return NULL;
+    }
+    tcs34725_step_t* step = &script->steps[script->step_count++];
+    memset(step, 0, sizeof(*step));
+    step->type = type;
+    return step;
+}
+
+
+static void fix_byte_order(const tcs34725_segment_t* segment) {
+#if defined(__BYTE_ORDER__) && (__BYTE_ORDER__ == __ORDER_BIG_ENDIAN__)
+    // The device sends little endian words
+    if(segment->kind == TCS34725_SEGMENT_CLEAR || segment->kind == TCS34725_SEGMENT_RGB){
+        for(uint8_t i = 0; i + 1 < segment->len; i += 2){
+            uint8_t low = segment->dest[i];
+            segment->dest[i] = segment->dest[i + 1];
+            segment->dest[i + 1] = low;
+        }
+    }
+#else
+    (void)segment;
+#endif
+}
+
+
+static void track_write(tcs34725_config_t* config, uint8_t command, const uint8_t* data, uint8_t len, bool written) {
+    /* Keep the register shadow and the settings of the config in sync with
+       what the script wrote, otherwise later tcs34725_set_* calls would be
+       dropped as redundant. A failed write leaves the device contents unknown */
+    uint8_t reg = command & 0b00011111;
+    for(uint8_t i = 0; i < len; i++){
+        uint8_t r = reg + i;
+        if(r >= sizeof(config->state.shadow)){
+            break;
+        }
+        if(written){
+            config->state.shadow[r] = data[i];
+            config->state.shadow_valid |= (1U << r);
+        }else{
+            config->state.shadow_valid &= ~(1U << r);
+        }
+        if(written && r == TCS34725_ENABLE_REG && !(data[i] & TCS34725_ENABLE_PON)){
+            // Powered down, nothing is being acquired any more
+            config->state.acquisition = TCS34725_STATE_IDLE;
+        }else if(written && r == TCS34725_ATIME_REG){
+            config->settings.integration_time = (tcs34725_integration_time_t)data[i];
+        }else if(written && r == TCS34725_CONTROL_REG){
+            config->settings.gain = (tcs34725_gain_t)(data[i] & 0b11);
+        }
+    }
+}
+
+
+void tcs34725_script_reset(tcs34725_script_t* script) {
+    script->step_count = 0;
+    script->segment_count = 0;
+    script->data_count = 0;
+}
+
+
+tcs34725_err_t tcs34725_script_write(tcs34725_script_t* script, uint8_t reg, const uint8_t* data, uint8_t len) {
+    if(len == 0 || script->data_count + len > TCS34725_SCRIPT_MAX_DATA){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+    tcs34725_step_t* step = add_step(script, TCS34725_STEP_WRITE);
+    if(step == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    step->command = command(reg);
+    step->first = script->data_count;
+    step->count = len;
+    memcpy(&script->data[script->data_count], data, len);
+    script->data_count += len;
+    return TCS34725_OK;
+}
+
+
+tcs34725_err_t tcs34725_script_clear_interrupt(tcs34725_script_t* script) {
+    tcs34725_step_t* step = add_step(script, TCS34725_STEP_COMMAND);
+    if(step == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+    step->command = TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_SF_MODE, TCS34725_SF_INT_CLEAR);
+    return TCS34725_OK;
+}
+
+
+tcs34725_err_t tcs34725_script_read(tcs34725_script_t* script, uint8_t reg, const tcs34725_segment_t* segments, uint8_t count) {
+    if(count == 0 || script->segment_count + count > TCS34725_SCRIPT_MAX_SEGMENTS){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+    tcs34725_step_t* step = add_step(script, TCS34725_STEP_READ);
+    if(step == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+
+    step->command = command(reg);
+    step->first = script->segment_count;
+    step->count = count;
+    memcpy(&script->segments[script->segment_count], segments, count * sizeof(*segments));
+    script->segment_count += count;
+    return TCS34725_OK;
+}
+
+
+tcs34725_err_t tcs34725_script_delay(tcs34725_script_t* script, uint16_t delay_ms) {
+    tcs34725_step_t* step = add_step(script, TCS34725_STEP_DELAY);
+    if(step == NULL){
+        return TCS34725_ERR_INVALID_ARG;
+    }
+    step->delay_ms = delay_ms;
+    return TCS34725_OK;
+}
+
+
+tcs34725_err_t tcs34725_script_fetch(tcs34725_script_t* script, tcs34725_color_t* color, uint8_t* status) {
+    tcs34725_segment_t segments[3];
+    uint8_t count = 0;
+    if(status != NULL){
+        segments[count++] = (tcs34725_segment_t){status, 1, TCS34725_SEGMENT_STATUS};
+    }
+    segments[count++] = (tcs34725_segment_t){(uint8_t*)&color->clear, 2, TCS34725_SEGMENT_CLEAR};
+    segments[count++] = (tcs34725_segment_t){(uint8_t*)&color->red, 6, TCS34725_SEGMENT_RGB};
+    return tcs34725_script_read(script, (status != NULL) ? TCS34725_STATUS_REG : TCS34725_CDATAL_REG, segments, count);
+}
+
+
+tcs34725_err_t tcs34725_script_one_shot(tcs34725_script_t* script, tcs34725_integration_time_t it, bool interrupt, tcs34725_color_t* color, uint8_t* status) {
+    tcs34725_err_t err = TCS34725_OK;
+    // A script cannot read ENABLE back, so the interrupt enable bit is fixed when it is built
+    const uint8_t off = interrupt ? TCS34725_ENABLE_AIEN : 0;
+    const uint8_t pon = off | TCS34725_ENABLE_PON;
+    const uint8_t pon_aen = off | TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN;
+    // 2.4ms per integration cycle (rounded up), plus 10% for the oscillator tolerance
+    uint32_t cycle = ((256 - (uint32_t)it) * 24 + 9) / 10;
+
+    err |= tcs34725_script_write(script, TCS34725_ENABLE_REG, &pon, 1);
+    err |= tcs34725_script_delay(script, 3);
+    err |= tcs34725_script_write(script, TCS34725_ENABLE_REG, &pon_aen, 1);
+    err |= tcs34725_script_delay(script, (uint16_t)(cycle + cycle / 10 + 1));
+    err |= tcs34725_script_fetch(script, color, status);
+    err |= tcs34725_script_write(script, TCS34725_ENABLE_REG, &off, 1);
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_script_configure(tcs34725_script_t* script, tcs34725_settings_t settings) {
+    tcs34725_err_t err = TCS34725_OK;
+    uint8_t atime = (uint8_t)settings.integration_time;
+    uint8_t control = (uint8_t)settings.gain;
+
+    // ATIME and CONTROL are not adjacent, two transactions
+    err |= tcs34725_script_write(script, TCS34725_ATIME_REG, &atime, 1);
+    err |= tcs34725_script_write(script, TCS34725_CONTROL_REG, &control, 1);
+    return err;
+}
+
+
+tcs34725_err_t tcs34725_script_rearm(tcs34725_script_t* script, uint16_t low, uint16_t high) {
+    tcs34725_err_t err = TCS34725_OK;
+    uint8_t limits[4] = {
+        (uint8_t)(low & 0xFF),
+        (uint8_t)(low >> 8),
+        (uint8_t)(high & 0xFF),
+        (uint8_t)(high >> 8),
+    };
+
+    err |= tcs34725_script_write(script, TCS34725_AILTL_REG, limits, sizeof(limits));
+    err |= tcs34725_script_clear_interrupt(script);
+    return err;
+}
+
+
+void tcs34725_script_retarget(tcs34725_script_t* script, tcs34725_color_t* color, uint8_t* status) {
+    for(uint8_t i = 0; i < script->segment_count; i++){
+        tcs34725_segment_t* segment = &script->segments[i];
+        switch (segment->kind) {
+        case TCS34725_SEGMENT_STATUS:
+            if(status != NULL){
+                segment->dest = status;
+            }
+            break;
+        case TCS34725_SEGMENT_CLEAR:
+            segment->dest = (uint8_t*)&color->clear;
+            break;
+        case TCS34725_SEGMENT_RGB:
+            segment->dest = (uint8_t*)&color->red;
+            break;
+        case TCS34725_SEGMENT_RAW:
+            break;
+        }
+    }
+}
+
+
+int8_t tcs34725_script_execute(const tcs34725_script_t* script, tcs34725_script_done_fptr_t done, void* done_ptr, void* user_ptr) {
+    tcs34725_config_t* config = (tcs34725_config_t*)user_ptr;
+    int8_t result = 0;
+
+    for(uint8_t s = 0; s < script->step_count && result == 0; s++){
+        const tcs34725_step_t* step = &script->steps[s];
+        const tcs34725_segment_t* segments = (step->type == TCS34725_STEP_READ) ? &script->segments[step->first] : NULL;
+        switch (step->type) {
+        case TCS34725_STEP_WRITE:
+            // The platform functions take bare register addresses, DMA backends send the command byte
+            result = config->write_reg(step->command & 0b00011111, &script->data[step->first], step->count, config->user_ptr);
+            track_write(config, step->command, &script->data[step->first], step->count, result == 0);
+            break;
+        case TCS34725_STEP_COMMAND:
+            result = config->write_byte(step->command, config->user_ptr);
+            break;
+        case TCS34725_STEP_READ:
+            if(step->count == 1){
+                result = config->read_reg(step->command & 0b00011111, segments[0].dest, segments[0].len, config->user_ptr);
+            }else{
+                /* read_reg has no scatter support, so the reference backend
+                   bounces through a buffer (DMA backends use the segments) */
+                uint8_t buf[TCS34725_BDATAH_REG + 1];
+                uint32_t len = 0;
+                for(uint8_t i = 0; i < step->count; i++){
+                    len += segments[i].len;
+                }
+                if(len > sizeof(buf)){
+                    result = -1;
+                    break;
+                }
+                result = config->read_reg(step->command & 0b00011111, buf, len, config->user_ptr);
+                for(uint8_t i = 0, offset = 0; result == 0 && i < step->count; offset += segments[i].len, i++){
+                    memcpy(segments[i].dest, &buf[offset], segments[i].len);
+                }
+            }
+            for(uint8_t i = 0; result == 0 && i < step->count; i++){
+                fix_byte_order(&segments[i]);
+            }
+            break;
+        case TCS34725_STEP_DELAY:
+            config->delay_ms(step->delay_ms);
+            break;
+        }
+    }
+
+    if(done != NULL){
+        done(result, done_ptr);
+    }
+    return 0;
+}
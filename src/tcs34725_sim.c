@@ -0,0 +1,379 @@
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include "tcs34725_sim.h"
+
+// Duration of one integration or wait step
+#define SIM_STEP_US         (2400)
+// Wait steps are 12x longer with WLONG
+#define SIM_WLONG_FACTOR    (12)
+// Resolution used to integrate a time varying light source
+#define SIM_LIGHT_STEP_US   (100)
+// Analog saturation, counts per integration step
+#define SIM_ANALOG_MAX      (1024.0F)
+
+// Channel order of accum and latch, same as the data registers
+enum { SIM_CLEAR, SIM_RED, SIM_GREEN, SIM_BLUE };
+
+/* Simulators driven by delay_ms and get_tick_ms (which have no user
+   pointer). All attached devices share the virtual clock */
+static tcs34725_sim_t* active_sims[TCS34725_SIM_MAX_DEVICES];
+static size_t active_count = 0;
+
+static void write_register(tcs34725_sim_t*, uint8_t, uint8_t);
+static uint8_t read_register(tcs34725_sim_t*, uint8_t);
+static void update_enable(tcs34725_sim_t*, uint8_t);
+static void start_integration(tcs34725_sim_t*);
+static void end_integration(tcs34725_sim_t*);
+static void end_phase(tcs34725_sim_t*);
+static void accumulate(tcs34725_sim_t*, uint64_t, uint64_t);
+static bool command(tcs34725_sim_t*, uint8_t);
+static bool fail(tcs34725_sim_t*);
+
+
+void tcs34725_sim_init(tcs34725_sim_t* sim, uint8_t id) {
+    memset(sim, 0, sizeof(*sim));
+    // Power-on register defaults
+    sim->regs[TCS34725_ATIME_REG] = 0xFF;
+    sim->regs[TCS34725_WTIME_REG] = 0xFF;
+    sim->regs[TCS34725_ID_REG] = id;
+    sim->phase = TCS34725_SIM_SLEEP;
+}
+
+
+tcs34725_err_t tcs34725_sim_attach(tcs34725_sim_t* sim, tcs34725_config_t* config) {
+    bool attached = false;
+    for(size_t i = 0; i < active_count; i++){
+        if(active_sims[i] == sim){
+            attached = true;
+        }
+    }
+    if(!attached){
+        // A simulator outside the shared clock would never advance and return stale data
+        if(active_count >= TCS34725_SIM_MAX_DEVICES){
+            return TCS34725_ERR_INVALID_ARG;
+        }
+        // Join the shared clock
+        if(active_count > 0){
+            sim->time_us = active_sims[0]->time_us;
+        }
+        active_sims[active_count++] = sim;
+    }
+
+    config->user_ptr = sim;
+    config->read_reg = tcs34725_sim_read_reg;
+    config->write_reg = tcs34725_sim_write_reg;
+    config->write_byte = tcs34725_sim_write_byte;
+    config->delay_ms = tcs34725_sim_delay_ms;
+    config->get_tick_ms = tcs34725_sim_get_tick_ms;
+    return TCS34725_OK;
+}
+
+
+void tcs34725_sim_detach_all(void) {
+    active_count = 0;
+}
+
+
+void tcs34725_sim_set_light(tcs34725_sim_t* sim, tcs34725_sim_light_t light) {
+    sim->light = light;
+    sim->light_fn = NULL;
+}
+
+
+void tcs34725_sim_set_light_fn(tcs34725_sim_t* sim, tcs34725_sim_light_fptr_t light_fn, void* user_ptr) {
+    sim->light_fn = light_fn;
+    sim->light_user_ptr = user_ptr;
+}
+
+
+bool tcs34725_sim_int_pin(const tcs34725_sim_t* sim) {
+    return (sim->regs[TCS34725_ENABLE_REG] & TCS34725_ENABLE_AIEN) &&
+           (sim->regs[TCS34725_STATUS_REG] & TCS34727_FLAG_AINT);
+}
+
+
+void tcs34725_sim_advance_us(tcs34725_sim_t* sim, uint64_t us) {
+    uint64_t target = sim->time_us + us;
+
+    while(sim->time_us < target){
+        if(sim->phase == TCS34725_SIM_SLEEP || sim->phase == TCS34725_SIM_IDLE){
+            // Nothing happens until the host writes ENABLE
+            sim->time_us = target;
+            break;
+        }
+
+        uint64_t step_end = (sim->phase_end_us < target) ? sim->phase_end_us : target;
+        if(sim->phase == TCS34725_SIM_INTEGRATING){
+            accumulate(sim, sim->time_us, step_end);
+        }
+        sim->time_us = step_end;
+        if(sim->time_us == sim->phase_end_us){
+            end_phase(sim);
+        }
+    }
+}
+
+
+static void accumulate(tcs34725_sim_t* sim, uint64_t from, uint64_t to) {
+    static const float gains[4] = { 1.0F, 4.0F, 16.0F, 60.0F };
+    float gain = gains[sim->regs[TCS34725_CONTROL_REG] & 0x03];
+
+    while(from < to){
+        // A static light is integrated in one go, a varying one in small steps
+        uint64_t end = to;
+        tcs34725_sim_light_t light = sim->light;
+        if(sim->light_fn != NULL){
+            if(end - from > SIM_LIGHT_STEP_US){
+                end = from + SIM_LIGHT_STEP_US;
+            }
+            sim->light_fn(from + (end - from) / 2, &light, sim->light_user_ptr);
+        }
+
+        float steps = (float)(end - from) / SIM_STEP_US;
+        float rates[4] = { light.clear, light.red, light.green, light.blue };
+        for(int i = 0; i < 4; i++){
+            // Analog saturation limits the counts per step
+            float rate = rates[i] * gain;
+            if(rate > SIM_ANALOG_MAX){
+                rate = SIM_ANALOG_MAX;
+            }else if(rate < 0.0F){
+                rate = 0.0F;
+            }
+            sim->accum[i] += rate * steps;
+        }
+        from = end;
+    }
+}
+
+
+static void start_integration(tcs34725_sim_t* sim) {
+    sim->cycle_atime = sim->regs[TCS34725_ATIME_REG];
+    memset(sim->accum, 0, sizeof(sim->accum));
+    sim->phase = TCS34725_SIM_INTEGRATING;
+    sim->phase_end_us = sim->time_us + (uint64_t)(256 - sim->cycle_atime) * SIM_STEP_US;
+}
+
+
+static void end_integration(tcs34725_sim_t* sim) {
+    // Digital saturation, rounded so that partial steps summed over several advances add up
+    for(int i = 0; i < 4; i++){
+        uint32_t counts = (sim->accum[i] >= 65535.0F) ? 65535 : (uint32_t)(sim->accum[i] + 0.5F);
+        sim->regs[TCS34725_CDATAL_REG + 2 * i] = counts & 0xFF;
+        sim->regs[TCS34725_CDATAH_REG + 2 * i] = counts >> 8;
+    }
+    sim->regs[TCS34725_STATUS_REG] |= TCS34727_FLAG_AVALID;
+    sim->cycles++;
+
+    // Interrupt threshold and persistence filter on the clear channel
+    uint16_t clear = sim->regs[TCS34725_CDATAL_REG] | (sim->regs[TCS34725_CDATAH_REG] << 8);
+    uint16_t low = sim->regs[TCS34725_AILTL_REG] | (sim->regs[TCS34725_AILTH_REG] << 8);
+    uint16_t high = sim->regs[TCS34725_AIHTL_REG] | (sim->regs[TCS34725_AIHTH_REG] << 8);
+    uint8_t apers = sim->regs[TCS34725_PERS_REG] & 0x0F;
+    // APERS 0-3 map to 0-3 cycles, then 5 cycles per step
+    uint8_t required = (apers <= 3) ? apers : (uint8_t)(5 * (apers - 3));
+
+    if(clear < low || clear > high){
+        if(sim->out_of_range < 255){
+            sim->out_of_range++;
+        }
+    }else{
+        sim->out_of_range = 0;
+    }
+    if(required == 0 || sim->out_of_range >= required){
+        sim->regs[TCS34725_STATUS_REG] |= TCS34727_FLAG_AINT;
+    }
+}
+
+
+static void end_phase(tcs34725_sim_t* sim) {
+    uint8_t enable = sim->regs[TCS34725_ENABLE_REG];
+
+    switch (sim->phase) {
+    case TCS34725_SIM_WARMUP:
+        start_integration(sim);
+        break;
+    case TCS34725_SIM_INTEGRATING:
+        end_integration(sim);
+        if(enable & TCS34725_ENABLE_WEN){
+            uint64_t step = SIM_STEP_US;
+            if(sim->regs[TCS34725_CONFIG_REG] & TCS34725_CONFIG_WLONG){
+                step *= SIM_WLONG_FACTOR;
+            }
+            sim->phase = TCS34725_SIM_WAITING;
+            sim->phase_end_us = sim->time_us + (uint64_t)(256 - sim->regs[TCS34725_WTIME_REG]) * step;
+        }else{
+            start_integration(sim);
+        }
+        break;
+    case TCS34725_SIM_WAITING:
+        start_integration(sim);
+        break;
+    case TCS34725_SIM_SLEEP:
+    case TCS34725_SIM_IDLE:
+        break;
+    }
+}
+
+
+static void update_enable(tcs34725_sim_t* sim, uint8_t value) {
+    uint8_t previous = sim->regs[TCS34725_ENABLE_REG];
+    value &= (TCS34725_ENABLE_AIEN | TCS34725_ENABLE_WEN | TCS34725_ENABLE_AEN | TCS34725_ENABLE_PON);
+    sim->regs[TCS34725_ENABLE_REG] = value;
+
+    if(!(value & TCS34725_ENABLE_PON)){
+        sim->phase = TCS34725_SIM_SLEEP;
+        sim->regs[TCS34725_STATUS_REG] &= ~TCS34727_FLAG_AVALID;
+        return;
+    }
+    if(!(previous & TCS34725_ENABLE_PON)){
+        // The oscillator needs 2.4ms before an integration can start
+        sim->warmup_end_us = sim->time_us + SIM_STEP_US;
+        sim->phase = TCS34725_SIM_IDLE;
+    }
+
+    if(!(value & TCS34725_ENABLE_AEN)){
+        sim->phase = TCS34725_SIM_IDLE;
+        sim->regs[TCS34725_STATUS_REG] &= ~TCS34727_FLAG_AVALID;
+    }else if(sim->phase == TCS34725_SIM_IDLE){
+        if(sim->time_us < sim->warmup_end_us){
+            sim->phase = TCS34725_SIM_WARMUP;
+            sim->phase_end_us = sim->warmup_end_us;
+        }else{
+            start_integration(sim);
+        }
+    }
+}
+
+
+static void write_register(tcs34725_sim_t* sim, uint8_t reg, uint8_t value) {
+    switch (reg) {
+    case TCS34725_ENABLE_REG:
+        update_enable(sim, value);
+        break;
+    case TCS34725_ATIME_REG:
+    case TCS34725_WTIME_REG:
+    case TCS34725_AILTL_REG:
+    case TCS34725_AILTH_REG:
+    case TCS34725_AIHTL_REG:
+    case TCS34725_AIHTH_REG:
+        sim->regs[reg] = value;
+        break;
+    case TCS34725_PERS_REG:
+        sim->regs[reg] = value & 0x0F;
+        break;
+    case TCS34725_CONFIG_REG:
+        sim->regs[reg] = value & TCS34725_CONFIG_WLONG;
+        break;
+    case TCS34725_CONTROL_REG:
+        sim->regs[reg] = value & 0x03;
+        break;
+    default:
+        // Read-only or reserved
+        break;
+    }
+}
+
+
+static uint8_t read_register(tcs34725_sim_t* sim, uint8_t reg) {
+    uint8_t value;
+    if(reg >= TCS34725_CDATAL_REG && reg <= TCS34725_BDATAH_REG){
+        // Reading a low byte latches the matching high byte
+        int channel = (reg - TCS34725_CDATAL_REG) / 2;
+        if(((reg - TCS34725_CDATAL_REG) & 1) == 0){
+            value = sim->regs[reg];
+            sim->latch[channel] = sim->regs[reg + 1];
+        }else{
+            value = sim->latch[channel];
+        }
+    }else{
+        value = sim->regs[reg];
+    }
+    return value;
+}
+
+
+// Decode a command byte, returns false for a special function (no data phase)
+static bool command(tcs34725_sim_t* sim, uint8_t reg_addr) {
+    if(!(reg_addr & (TCS34725_COMMAND_BIT << 7))){
+        reg_addr = TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_INCREMENT_ADDR, reg_addr);
+    }
+    uint8_t type = (reg_addr >> 5) & 0x03;
+    uint8_t address = reg_addr & 0x1F;
+
+    if(type == TCS34725_SF_MODE){
+        if(address == TCS34725_SF_INT_CLEAR){
+            sim->regs[TCS34725_STATUS_REG] &= ~TCS34727_FLAG_AINT;
+            sim->out_of_range = 0;
+        }
+        return false;
+    }
+    sim->pointer = address;
+    sim->transaction = type;
+    return true;
+}
+
+
+static bool fail(tcs34725_sim_t* sim) {
+    if(sim->fail_next > 0){
+        sim->fail_next--;
+        return true;
+    }
+    return false;
+}
+
+
+int8_t tcs34725_sim_read_reg(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    tcs34725_sim_t* sim = (tcs34725_sim_t*)user_ptr;
+    if(fail(sim)){
+        return -1;
+    }
+    if(command(sim, reg_addr)){
+        for(uint32_t i = 0; i < len; i++){
+            reg_data[i] = read_register(sim, sim->pointer);
+            if(sim->transaction == TCS34725_INCREMENT_ADDR){
+                sim->pointer = (sim->pointer + 1) & 0x1F;
+            }
+        }
+    }
+    return 0;
+}
+
+
+int8_t tcs34725_sim_write_reg(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    tcs34725_sim_t* sim = (tcs34725_sim_t*)user_ptr;
+    if(fail(sim)){
+        return -1;
+    }
+    if(command(sim, reg_addr)){
+        for(uint32_t i = 0; i < len; i++){
+            write_register(sim, sim->pointer, reg_data[i]);
+            if(sim->transaction == TCS34725_INCREMENT_ADDR){
+                sim->pointer = (sim->pointer + 1) & 0x1F;
+            }
+        }
+    }
+    return 0;
+}
+
+
+int8_t tcs34725_sim_write_byte(uint8_t single_byte, void* user_ptr) {
+    tcs34725_sim_t* sim = (tcs34725_sim_t*)user_ptr;
+    if(fail(sim)){
+        return -1;
+    }
+    command(sim, single_byte);
+    return 0;
+}
+
+
+void tcs34725_sim_delay_ms(uint32_t period) {
+    for(size_t i = 0; i < active_count; i++){
+        tcs34725_sim_advance_us(active_sims[i], (uint64_t)period * 1000);
+    }
+}
+
+
+uint32_t tcs34725_sim_get_tick_ms(void) {
+    return (active_count > 0) ? (uint32_t)(active_sims[0]->time_us / 1000) : 0;
+}
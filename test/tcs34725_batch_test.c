@@ -0,0 +1,241 @@
+// Equivalence test of the batch conversion kernels.
+//
+// Runs every AoS and SoA kernel over random samples plus edge values
+// (0, 65535, clear = 0) and compares each result with the scalar
+// conversion, using the guarantees documented in tcs34725_batch.h:
+//  - normalized RGB, XYZ, lux and DN40 bit-for-bit identical
+//  - McCamy CCT |error| <= 1K
+// Only results that are in range for the scalar version are compared.
+// Batch lengths cover the SIMD remainder loop and the 256 sample AoS chunk
+// tail. The SIMD path is chosen by the compiler target, so build the test
+// once per path:
+//   default x86-64 (SSE2), -mavx2, ARM with NEON, -DTCS34725_BATCH_NO_SIMD
+// With TCS34725_FIXED_POINT the scalar lux and McCamy CCT use the integer
+// paths, so the float formulas they replace are used as the reference
+// instead. The exit status is non-zero if a check fails.
+//
+// Build: cc -O2 -ffp-contract=off -Iinc src/tcs34725.c src/tcs34725_batch.c test/tcs34725_batch_test.c -lm -o tcs34725_batch_test
+
+#include <stdio.h>
+#include <math.h>
+#include "tcs34725.h"
+#include "tcs34725_batch.h"
+
+// McCamy bound, powf is replaced by multiplications
+#define CCT_BOUND (1.0)
+// Samples per batch length
+#define MAX_SAMPLES (4099)
+
+static tcs34725_color_t colors[MAX_SAMPLES];
+static uint16_t red[MAX_SAMPLES], green[MAX_SAMPLES], blue[MAX_SAMPLES], clear[MAX_SAMPLES];
+static tcs34725_normalized_color_t normalized[MAX_SAMPLES];
+static float soa_f[3][MAX_SAMPLES];
+static tcs34725_xyz_t xyz[MAX_SAMPLES];
+static uint16_t out[MAX_SAMPLES], out_soa[MAX_SAMPLES];
+
+static uint32_t rng_state = 0x2468ACE1;
+static unsigned long failures;
+static double worst_cct;
+
+
+static uint16_t random16(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (uint16_t)rng_state;
+}
+
+
+static void fail(const char* what, size_t n, size_t i) {
+    if(failures < 20){
+        printf("%s: n=%zu i=%zu r=%u g=%u b=%u c=%u\n", what, n, i,
+               colors[i].red, colors[i].green, colors[i].blue, colors[i].clear);
+    }
+    failures++;
+}
+
+
+/* Float references, same expressions as the float build of the driver.
+   The results are kept in float so that out of range values can be skipped */
+static float lux_float(tcs34725_color_t color) {
+    return (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+}
+
+
+static float cct_float(tcs34725_color_t color) {
+    float X = (-0.14282F * color.red) + (1.54924F * color.green) + (-0.95641F * color.blue);
+    float Y = (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+    float Z = (-0.68202F * color.red) + (0.77073F * color.green) + (0.56332F * color.blue);
+    float xc = (X) / (X + Y + Z);
+    float yc = (Y) / (X + Y + Z);
+    float n = (xc - 0.3320F) / (0.1858F - yc);
+    return (449.0F * powf(n, 3)) + (3525.0F * powf(n, 2)) + (6823.3F * n) + 5520.33F;
+}
+
+
+static uint16_t scalar_lux(tcs34725_color_t color) {
+#ifdef TCS34725_FIXED_POINT
+    return (uint16_t)lux_float(color);
+#else
+    return tcs34725_calculate_lux(color);
+#endif
+}
+
+
+static uint16_t scalar_cct(tcs34725_color_t color) {
+#ifdef TCS34725_FIXED_POINT
+    return (uint16_t)cct_float(color);
+#else
+    return tcs34725_calculate_color_temperature(color);
+#endif
+}
+
+
+static void fill(size_t n) {
+    for(size_t i = 0; i < n; i++){
+        tcs34725_color_t color = { random16(), random16(), random16(), random16() };
+        // Every 8th sample is dim, so that ratios and in-range results are common
+        if((i & 7) == 0){
+            color.red >>= 6;
+            color.green >>= 6;
+            color.blue >>= 6;
+            color.clear >>= 5;
+        }
+        // Edge values
+        switch (i % 61) {
+        case 0:  color.clear = 0; break;
+        case 1:  color.red = 0; color.green = 0; color.blue = 0; break;
+        case 2:  color.red = 65535; color.green = 65535; color.blue = 65535; color.clear = 65535; break;
+        case 3:  color.green = 0; break;
+        default: break;
+        }
+        colors[i] = color;
+        red[i] = color.red;
+        green[i] = color.green;
+        blue[i] = color.blue;
+        clear[i] = color.clear;
+    }
+}
+
+
+static void check_batch(size_t n, tcs34725_config_t* config) {
+    const tcs34725_color_soa_t soa = { red, green, blue, clear };
+    fill(n);
+
+    // Normalized RGB, same expression as tcs34725_get_normalized_RGB
+    tcs34725_batch_normalized_RGB(colors, n, normalized);
+    tcs34725_batch_normalized_RGB_soa(&soa, n, soa_f[0], soa_f[1], soa_f[2]);
+    for(size_t i = 0; i < n; i++){
+        uint32_t sum = colors[i].clear;
+        float r = (sum == 0) ? 0.0F : (float)((float)colors[i].red / sum * 255.0);
+        float g = (sum == 0) ? 0.0F : (float)((float)colors[i].green / sum * 255.0);
+        float b = (sum == 0) ? 0.0F : (float)((float)colors[i].blue / sum * 255.0);
+        if(normalized[i].red != r || normalized[i].green != g || normalized[i].blue != b){
+            fail("normalized", n, i);
+        }
+        if(soa_f[0][i] != r || soa_f[1][i] != g || soa_f[2][i] != b){
+            fail("normalized_soa", n, i);
+        }
+    }
+
+    // XYZ, same expressions as tcs34725_calculate_color_temperature
+    tcs34725_batch_xyz(colors, n, xyz);
+    tcs34725_batch_xyz_soa(&soa, n, soa_f[0], soa_f[1], soa_f[2]);
+    for(size_t i = 0; i < n; i++){
+        tcs34725_color_t c = colors[i];
+        float X = (-0.14282F * c.red) + (1.54924F * c.green) + (-0.95641F * c.blue);
+        float Y = (-0.32466F * c.red) + (1.57837F * c.green) + (-0.73191F * c.blue);
+        float Z = (-0.68202F * c.red) + (0.77073F * c.green) + (0.56332F * c.blue);
+        if(xyz[i].X != X || xyz[i].Y != Y || xyz[i].Z != Z){
+            fail("xyz", n, i);
+        }
+        if(soa_f[0][i] != X || soa_f[1][i] != Y || soa_f[2][i] != Z){
+            fail("xyz_soa", n, i);
+        }
+    }
+
+    // Lux
+    tcs34725_batch_lux(colors, n, out);
+    tcs34725_batch_lux_soa(&soa, n, out_soa);
+    for(size_t i = 0; i < n; i++){
+        float l = lux_float(colors[i]);
+        if(out[i] != out_soa[i]){
+            fail("lux_soa", n, i);
+        }else if(l >= 0.0F && l < 65535.0F && out[i] != scalar_lux(colors[i])){
+            fail("lux", n, i);
+        }
+    }
+
+    // McCamy CCT
+    tcs34725_batch_color_temperature(colors, n, out);
+    tcs34725_batch_color_temperature_soa(&soa, n, out_soa);
+    for(size_t i = 0; i < n; i++){
+        tcs34725_color_t c = colors[i];
+        if(out[i] != out_soa[i]){
+            fail("cct_soa", n, i);
+        }else if(c.red == 0 && c.green == 0 && c.blue == 0){
+            if(out[i] != 0){
+                fail("cct dark", n, i);
+            }
+        }else{
+            float t = cct_float(c);
+            if(t >= 0.0F && t < 65535.0F){
+                double error = fabs((double)out[i] - scalar_cct(c));
+                if(error > worst_cct){
+                    worst_cct = error;
+                }
+                if(error > CCT_BOUND){
+                    fail("cct", n, i);
+                }
+            }
+        }
+    }
+
+    // DN40 for every integration time
+    const tcs34725_integration_time_t times[] = {
+        TCS34725_INTEGRATIONTIME_2_4MS, TCS34725_INTEGRATIONTIME_24MS, TCS34725_INTEGRATIONTIME_50MS,
+        TCS34725_INTEGRATIONTIME_101MS, TCS34725_INTEGRATIONTIME_154MS, TCS34725_INTEGRATIONTIME_700MS,
+    };
+    for(size_t t = 0; t < sizeof(times) / sizeof(times[0]); t++){
+        config->settings.integration_time = times[t];
+        tcs34725_batch_color_temperature_dn40(colors, n, times[t], out);
+        tcs34725_batch_color_temperature_dn40_soa(&soa, n, times[t], out_soa);
+        for(size_t i = 0; i < n; i++){
+            if(out[i] != out_soa[i]){
+                fail("dn40_soa", n, i);
+            }else if(out[i] != tcs34725_calculate_color_temperature_dn40(colors[i], config)){
+                fail("dn40", n, i);
+            }
+        }
+    }
+}
+
+
+int main(void) {
+    // Empty, SIMD remainders, AoS chunk boundaries (256) and tails
+    const size_t lengths[] = { 0, 1, 3, 4, 7, 8, 9, 15, 17, 255, 256, 257, 511, 513, 1000, MAX_SAMPLES };
+    tcs34725_config_t config = { 0 };
+
+#if defined(TCS34725_BATCH_NO_SIMD)
+    const char* path = "scalar";
+#elif defined(__AVX2__)
+    const char* path = "AVX2";
+#elif defined(__SSE2__)
+    const char* path = "SSE2";
+#elif defined(__ARM_NEON)
+    const char* path = "NEON";
+#else
+    const char* path = "scalar";
+#endif
+
+    for(int round = 0; round < 50; round++){
+        for(size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++){
+            check_batch(lengths[l], &config);
+        }
+    }
+
+    printf("%s path, worst McCamy |error| %.1fK (bound %.1fK), %lu failures\n", path, worst_cct, CCT_BOUND, failures);
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
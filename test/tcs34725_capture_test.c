@@ -0,0 +1,338 @@
+// Test of the binary capture format.
+//
+// A capture is written the way a logger does it (small buffer, flush,
+// restart) with timestamp and channel deltas chosen to cover every varint
+// length and both zigzag signs, including the 0 <-> 65535 jumps and a
+// wrapping tick. The test checks:
+//  - the round trip is exact, from memory and through the mmap reader
+//  - a flipped payload, magic or length byte loses exactly the samples of
+//    that block, a truncated file exactly the tail block
+//  - seek lands on the first sample at or after the time, also with a
+//    damaged block on the way or at the target
+//  - header validation and the full buffer
+// The exit status is non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725_capture.c src/tcs34725_capture_mmap.c test/tcs34725_capture_test.c -o tcs34725_capture_test
+
+#include <stdio.h>
+#include <string.h>
+#include "tcs34725_capture.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+#define SAMPLES     (3000)
+#define FILE_SIZE   (SAMPLES * 18 + 4096)
+#define WRITER_SIZE (4000)
+#define FILE_NAME   "tcs34725_capture_test.bin"
+
+static tcs34725_sample_t samples[SAMPLES];
+static size_t sample_block[SAMPLES];           // Block header offset of every sample
+static uint8_t image[FILE_SIZE], damaged[FILE_SIZE];
+static size_t image_size;
+
+static tcs34725_sample_t expected[SAMPLES];   // Samples that survive a damage
+static size_t expected_count;
+
+static uint32_t rng_state = 0x0BADCAFE;
+static int failures;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        if(failures < 20){
+            printf("line %d: %s failed\n", line, what);
+        }
+        failures++;
+    }
+}
+
+
+static uint16_t random16(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (uint16_t)rng_state;
+}
+
+
+static bool same(const tcs34725_sample_t* a, const tcs34725_sample_t* b) {
+    return a->timestamp == b->timestamp && a->status == b->status &&
+           a->color.clear == b->color.clear && a->color.red == b->color.red &&
+           a->color.green == b->color.green && a->color.blue == b->color.blue;
+}
+
+
+static void generate(void) {
+    // Starts close to the tick wrap, so it wraps within the first blocks
+    uint32_t time = 0xFFFFF000u;
+    tcs34725_color_t color = { 100, 200, 300, 1000 };
+
+    for(size_t i = 0; i < SAMPLES; i++){
+        // Timestamp deltas of 1 to 5 varint bytes (the longest once, the span stays below 2^31) and repeats
+        switch (i % 97) {
+        case 10: time += 0;       break;
+        case 20: time += 200;     break;
+        case 30: time += 20000;   break;
+        case 40: time += 3000000; break;
+        default: time += (i == 50) ? 0x10000000u : 24; break;
+        }
+        // Mostly slow drift, sometimes full scale jumps either way
+        switch (i % 13) {
+        case 0:  color.clear = (color.clear < 32768) ? 65535 : 0; break;
+        case 1:  color.red = random16(); color.green = random16(); color.blue = random16(); break;
+        default:
+            color.clear += (random16() % 9) - 4;
+            color.red += (random16() % 3) - 1;
+            break;
+        }
+        samples[i].timestamp = time;
+        samples[i].status = (uint8_t)random16();
+        samples[i].color = color;
+    }
+}
+
+
+static void write_capture(void) {
+    static uint8_t buffer[WRITER_SIZE];
+    const tcs34725_settings_t settings = { TCS34725_GAIN_16X, TCS34725_INTEGRATIONTIME_24MS };
+    tcs34725_capture_writer_t writer;
+    CHECK(tcs34725_capture_writer_init(&writer, buffer, sizeof(buffer), settings, TCS34725_ID) == TCS34725_OK);
+
+    // Flush and restart whenever the buffer is full, like a logger writing to a file
+    image_size = 0;
+    for(size_t i = 0; i < SAMPLES; i++){
+        if(tcs34725_capture_append(&writer, &samples[i]) != TCS34725_OK){
+            tcs34725_capture_flush(&writer);
+            memcpy(&image[image_size], buffer, writer.length);
+            image_size += writer.length;
+            tcs34725_capture_writer_restart(&writer);
+            CHECK(tcs34725_capture_append(&writer, &samples[i]) == TCS34725_OK);
+        }
+    }
+    tcs34725_capture_flush(&writer);
+    memcpy(&image[image_size], buffer, writer.length);
+    image_size += writer.length;
+}
+
+
+static void test_round_trip(void) {
+    tcs34725_capture_reader_t reader;
+    tcs34725_capture_iter_t iter;
+    tcs34725_sample_t sample;
+    CHECK(tcs34725_capture_reader_init(&reader, image, image_size) == TCS34725_OK);
+    CHECK(reader.id == TCS34725_ID);
+    CHECK(reader.settings.gain == TCS34725_GAIN_16X && reader.settings.integration_time == TCS34725_INTEGRATIONTIME_24MS);
+
+    // Exact, and remember which block every sample is in
+    size_t n = 0, blocks = 0;
+    tcs34725_capture_begin(&reader, &iter);
+    while(tcs34725_capture_next(&iter, &sample)){
+        if(n < SAMPLES){
+            CHECK(same(&sample, &samples[n]));
+            sample_block[n] = iter.block;
+            blocks += (n == 0 || sample_block[n] != sample_block[n - 1]);
+        }
+        n++;
+    }
+    printf("%d samples, %zu bytes, %zu blocks\n", SAMPLES, image_size, blocks);
+    CHECK(n == SAMPLES);
+    CHECK(iter.bad_blocks == 0);
+    CHECK(blocks > 10);
+
+    // Same through a file and the mmap reader
+    FILE* file = fopen(FILE_NAME, "wb");
+    CHECK(file != NULL);
+    if(file == NULL){
+        return;
+    }
+    CHECK(fwrite(image, 1, image_size, file) == image_size);
+    fclose(file);
+    CHECK(tcs34725_capture_open(&reader, FILE_NAME) == TCS34725_OK);
+    n = 0;
+    tcs34725_capture_begin(&reader, &iter);
+    while(tcs34725_capture_next(&iter, &sample) && n < SAMPLES){
+        CHECK(same(&sample, &samples[n]));
+        n++;
+    }
+    CHECK(n == SAMPLES);
+    tcs34725_capture_close(&reader);
+    CHECK(reader.data == NULL);
+    remove(FILE_NAME);
+    CHECK(tcs34725_capture_open(&reader, FILE_NAME) == TCS34725_ERR_READ);
+}
+
+
+static size_t block_offset(size_t k) {
+    // Header offset of the k-th block
+    size_t found = 0;
+    for(size_t i = 1; i < SAMPLES; i++){
+        if(sample_block[i] != sample_block[i - 1] && ++found == k){
+            return sample_block[i];
+        }
+    }
+    return sample_block[0];
+}
+
+
+static void expect_without(size_t first_block, size_t last_block) {
+    // Every sample except those of the blocks with a header in [first_block, last_block]
+    expected_count = 0;
+    for(size_t i = 0; i < SAMPLES; i++){
+        if(sample_block[i] < first_block || sample_block[i] > last_block){
+            expected[expected_count++] = samples[i];
+        }
+    }
+}
+
+
+static void read_damaged(size_t size, uint32_t bad_blocks) {
+    tcs34725_capture_reader_t reader;
+    tcs34725_capture_iter_t iter;
+    tcs34725_sample_t sample;
+    CHECK(tcs34725_capture_reader_init(&reader, damaged, size) == TCS34725_OK);
+
+    size_t n = 0;
+    tcs34725_capture_begin(&reader, &iter);
+    while(tcs34725_capture_next(&iter, &sample)){
+        CHECK(n < expected_count && same(&sample, &expected[n]));
+        n++;
+    }
+    CHECK(n == expected_count);
+    CHECK(iter.bad_blocks == bad_blocks);
+}
+
+
+static void test_damage(void) {
+    const size_t k = block_offset(5), next = block_offset(6), far = block_offset(9);
+
+    // A payload byte, the magic, the length: the block is skipped on its own
+    const size_t offsets[] = { k + TCS34725_CAPTURE_BLOCK_HEADER + 17, k + 1, k + 4, k + 9, next - 1 };
+    for(size_t i = 0; i < sizeof(offsets) / sizeof(offsets[0]); i++){
+        memcpy(damaged, image, image_size);
+        damaged[offsets[i]] ^= 0x10;
+        expect_without(k, k);
+        read_damaged(image_size, 1);
+    }
+
+    // Two separate damaged blocks count twice, adjacent ones once
+    memcpy(damaged, image, image_size);
+    damaged[k + 30] ^= 0xFF;
+    damaged[far + 30] ^= 0xFF;
+    expected_count = 0;
+    for(size_t i = 0; i < SAMPLES; i++){
+        if(sample_block[i] != k && sample_block[i] != far){
+            expected[expected_count++] = samples[i];
+        }
+    }
+    read_damaged(image_size, 2);
+    memcpy(damaged, image, image_size);
+    damaged[k + 30] ^= 0xFF;
+    damaged[next + 30] ^= 0xFF;
+    expect_without(k, next);
+    read_damaged(image_size, 1);
+
+    // Truncated in the payload or the header of the last block, or at a block boundary
+    const size_t last = sample_block[SAMPLES - 1];
+    memcpy(damaged, image, image_size);
+    expect_without(last, last);
+    read_damaged(last + TCS34725_CAPTURE_BLOCK_HEADER + 40, 1);
+    read_damaged(last + 7, 1);
+    read_damaged(last, 0);
+    expect_without(k, image_size);
+    read_damaged(k + 100, 1);
+}
+
+
+static size_t first_at(uint32_t time) {
+    // Index of the first expected sample at or after time (wrapping tick)
+    for(size_t i = 0; i < expected_count; i++){
+        if((int32_t)(expected[i].timestamp - time) >= 0){
+            return i;
+        }
+    }
+    return expected_count;
+}
+
+
+static void seek_check(const uint8_t* data, uint32_t time) {
+    tcs34725_capture_reader_t reader;
+    tcs34725_capture_iter_t iter;
+    tcs34725_sample_t sample;
+    CHECK(tcs34725_capture_reader_init(&reader, data, image_size) == TCS34725_OK);
+    tcs34725_capture_seek(&reader, &iter, time);
+
+    // Lands on the right sample and continues in order from there
+    size_t i = first_at(time);
+    for(size_t n = 0; n < 3 && i < expected_count; n++, i++){
+        CHECK(tcs34725_capture_next(&iter, &sample) && same(&sample, &expected[i]));
+    }
+    if(i == expected_count){
+        CHECK(!tcs34725_capture_next(&iter, &sample));
+    }
+}
+
+
+static void test_seek(void) {
+    // Every sample time, just before and just after it, the wrap, both ends
+    expect_without(1, 0);
+    for(size_t i = 0; i < SAMPLES; i++){
+        seek_check(image, samples[i].timestamp);
+        seek_check(image, samples[i].timestamp - 1);
+        seek_check(image, samples[i].timestamp + 1);
+    }
+    seek_check(image, 0);
+    seek_check(image, 0xFFFFFFFFu);
+    seek_check(image, samples[0].timestamp - 1000);
+    seek_check(image, samples[SAMPLES - 1].timestamp + 1000);
+
+    // A damaged payload or length before or at the target
+    const size_t k = block_offset(5);
+    const size_t offsets[] = { k + TCS34725_CAPTURE_BLOCK_HEADER + 17, k + 4 };
+    for(size_t d = 0; d < sizeof(offsets) / sizeof(offsets[0]); d++){
+        memcpy(damaged, image, image_size);
+        damaged[offsets[d]] ^= 0x10;
+        expect_without(k, k);
+        for(size_t i = 0; i < SAMPLES; i++){
+            if(sample_block[i] >= block_offset(3) && sample_block[i] <= block_offset(8)){
+                seek_check(damaged, samples[i].timestamp);
+            }
+        }
+    }
+}
+
+
+static void test_invalid(void) {
+    tcs34725_capture_reader_t reader;
+
+    // File header: magic, version, CRC, size
+    for(size_t i = 0; i < TCS34725_CAPTURE_HEADER_SIZE; i++){
+        memcpy(damaged, image, TCS34725_CAPTURE_HEADER_SIZE);
+        damaged[i] ^= 0x01;
+        CHECK(tcs34725_capture_reader_init(&reader, damaged, image_size) == TCS34725_ERR_READ);
+    }
+    CHECK(tcs34725_capture_reader_init(&reader, image, TCS34725_CAPTURE_HEADER_SIZE - 1) == TCS34725_ERR_READ);
+
+    // The smallest buffer holds one worst case sample, the next one is refused
+    static uint8_t buffer[TCS34725_CAPTURE_HEADER_SIZE + TCS34725_CAPTURE_BLOCK_HEADER + 18];
+    const tcs34725_settings_t settings = { TCS34725_GAIN_1X, TCS34725_INTEGRATIONTIME_2_4MS };
+    tcs34725_capture_writer_t writer;
+    CHECK(tcs34725_capture_writer_init(&writer, buffer, sizeof(buffer) - 1, settings, TCS34725_ID) == TCS34725_ERR_INVALID_ARG);
+    CHECK(tcs34725_capture_writer_init(&writer, buffer, sizeof(buffer), settings, TCS34725_ID) == TCS34725_OK);
+    CHECK(tcs34725_capture_append(&writer, &samples[0]) == TCS34725_OK);
+    size_t length = writer.length;
+    CHECK(tcs34725_capture_append(&writer, &samples[1]) == TCS34725_ERR_WRITE);
+    CHECK(writer.length == length);
+}
+
+
+int main(void) {
+    generate();
+    write_capture();
+    test_round_trip();
+    test_damage();
+    test_seek();
+    test_invalid();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
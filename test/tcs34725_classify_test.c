@@ -0,0 +1,177 @@
+// Equivalence test of the grid pruned classifier.
+//
+// Every lookup is compared with a linear scan over the whole palette using
+// the same distance expression, so index, distance and confidence must be
+// identical (ties go to the lower palette index in both). Palettes range
+// from a single reference to a few hundred, random, clustered into one
+// cell and with duplicate chromaticities. Samples are random, exactly on
+// grid lines and corners, and on the midpoint between two references
+// (ties). The reject threshold and the batch version are checked as well.
+// The exit status is non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725_classify.c test/tcs34725_classify_test.c -lm -o tcs34725_classify_test
+
+#include <stdio.h>
+#include <math.h>
+#include "tcs34725_classify.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+#define MAX_PALETTE    (400)
+#define MAX_CANDIDATES (GRID_CELLS * MAX_PALETTE)
+#define GRID_CELLS     (TCS34725_CLASSIFY_GRID * TCS34725_CLASSIFY_GRID)
+#define BATCH          (64)
+
+static tcs34725_normalized_color_t palette[MAX_PALETTE];
+static tcs34725_chromaticity_t points[MAX_PALETTE];
+static uint16_t candidates[MAX_CANDIDATES];
+
+static uint32_t rng_state = 0x5EED1234;
+static unsigned long failures, lookups, rejected;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        if(failures < 20){
+            printf("line %d: %s failed\n", line, what);
+        }
+        failures++;
+    }
+}
+
+
+static uint16_t random16(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (uint16_t)rng_state;
+}
+
+
+static tcs34725_normalized_color_t random_color(void) {
+    tcs34725_normalized_color_t color = { random16() / 257.0F, random16() / 257.0F, random16() / 257.0F };
+    return color;
+}
+
+
+static tcs34725_classification_t linear(const tcs34725_classifier_t* classifier, tcs34725_normalized_color_t color) {
+    // Reference: every palette entry, same expressions as tcs34725_classify
+    tcs34725_chromaticity_t p = tcs34725_chromaticity(color);
+    uint16_t index = TCS34725_CLASSIFY_REJECT;
+    float best = INFINITY, second = INFINITY;
+    for(uint16_t i = 0; i < classifier->count; i++){
+        float dr = p.r - classifier->points[i].r;
+        float dg = p.g - classifier->points[i].g;
+        float d = dr * dr + dg * dg;
+        if(d < best){
+            second = best;
+            best = d;
+            index = i;
+        }else if(d < second){
+            second = d;
+        }
+    }
+
+    tcs34725_classification_t result;
+    result.distance = sqrtf(best);
+    result.confidence = (second == INFINITY) ? 1.0F : (second > 0.0F) ? 1.0F - result.distance / sqrtf(second) : 0.0F;
+    result.index = (classifier->reject > 0.0F && result.distance > classifier->reject) ? TCS34725_CLASSIFY_REJECT : index;
+    return result;
+}
+
+
+static void compare(const tcs34725_classifier_t* classifier, tcs34725_normalized_color_t color) {
+    tcs34725_classification_t grid = tcs34725_classify(classifier, color);
+    tcs34725_classification_t scan = linear(classifier, color);
+    if(grid.index != scan.index || grid.distance != scan.distance || grid.confidence != scan.confidence){
+        if(failures < 20){
+            tcs34725_chromaticity_t p = tcs34725_chromaticity(color);
+            printf("palette %u, r=%.9g g=%.9g: grid %u (%.9g), linear %u (%.9g)\n", classifier->count, p.r, p.g,
+                   grid.index, grid.distance, scan.index, scan.distance);
+        }
+        failures++;
+    }
+    rejected += (scan.index == TCS34725_CLASSIFY_REJECT);
+    lookups++;
+}
+
+
+static void check_palette(uint16_t count, float reject) {
+    tcs34725_classifier_t classifier;
+    size_t used = 0;
+    CHECK(tcs34725_classify_init(&classifier, palette, count, points, candidates, MAX_CANDIDATES, &used, reject) == TCS34725_OK);
+
+    // Random samples
+    for(int i = 0; i < 20000; i++){
+        compare(&classifier, random_color());
+    }
+
+    // Grid lines and corners: R + G + B = 4 * GRID makes r and g exact multiples of a quarter cell
+    const int steps = 4 * TCS34725_CLASSIFY_GRID;
+    for(int r = 0; r <= steps; r++){
+        for(int g = 0; g <= steps - r; g++){
+            tcs34725_normalized_color_t color = { (float)r, (float)g, (float)(steps - r - g) };
+            compare(&classifier, color);
+        }
+    }
+
+    // Midpoints between two references, the first and second nearest are (nearly) tied
+    for(int i = 0; i < 5000 && count > 1; i++){
+        const tcs34725_chromaticity_t a = points[random16() % count], b = points[random16() % count];
+        float r = (a.r + b.r) / 2.0F, g = (a.g + b.g) / 2.0F;
+        tcs34725_normalized_color_t color = { r, g, 1.0F - r - g };
+        compare(&classifier, color);
+    }
+
+    // The batch version gives the same results
+    tcs34725_normalized_color_t colors[BATCH];
+    tcs34725_classification_t results[BATCH];
+    for(int i = 0; i < BATCH; i++){
+        colors[i] = random_color();
+    }
+    tcs34725_classify_batch(&classifier, colors, BATCH, results);
+    for(int i = 0; i < BATCH; i++){
+        tcs34725_classification_t single = tcs34725_classify(&classifier, colors[i]);
+        CHECK(results[i].index == single.index && results[i].distance == single.distance);
+    }
+
+    // Candidate storage: exactly used entries are needed
+    size_t needed = 0;
+    CHECK(tcs34725_classify_init(&classifier, palette, count, points, candidates, used, &needed, reject) == TCS34725_OK);
+    CHECK(needed == used);
+    CHECK(tcs34725_classify_init(&classifier, palette, count, points, candidates, used - 1, &needed, reject) == TCS34725_ERR_INVALID_ARG);
+    printf("palette %3u, reject %.2f: %5.1f candidates per cell\n", count, reject, (double)used / GRID_CELLS);
+}
+
+
+int main(void) {
+    const uint16_t sizes[] = { 1, 2, 3, 8, 24, 64, 150, MAX_PALETTE };
+    for(size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++){
+        for(uint16_t i = 0; i < sizes[s]; i++){
+            palette[i] = random_color();
+        }
+        check_palette(sizes[s], 0.0F);
+        check_palette(sizes[s], 0.05F);
+    }
+
+    // Clustered into one cell, and duplicated chromaticities (confidence 0)
+    for(uint16_t i = 0; i < 40; i++){
+        palette[i] = (tcs34725_normalized_color_t){ 100.0F + random16() % 8, 100.0F + random16() % 8, 100.0F };
+    }
+    palette[40] = palette[3];
+    palette[41] = (tcs34725_normalized_color_t){ palette[7].red * 2.0F, palette[7].green * 2.0F, palette[7].blue * 2.0F };
+    check_palette(42, 0.0F);
+    check_palette(42, 0.02F);
+
+    // Invalid palettes
+    tcs34725_classifier_t classifier;
+    CHECK(tcs34725_classify_init(&classifier, palette, 0, points, candidates, MAX_CANDIDATES, NULL, 0.0F) == TCS34725_ERR_INVALID_ARG);
+    CHECK(tcs34725_classify_init(&classifier, palette, TCS34725_CLASSIFY_REJECT, points, candidates, MAX_CANDIDATES, NULL, 0.0F) == TCS34725_ERR_INVALID_ARG);
+
+    // The reject threshold was exercised both ways
+    printf("%lu lookups, %lu rejected, %lu failures\n", lookups, rejected, failures);
+    CHECK(rejected > 0 && rejected < lookups);
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
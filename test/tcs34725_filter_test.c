@@ -0,0 +1,162 @@
+// Test of the ripple rejecting decimation filter.
+//
+// Samples are generated analytically: a light with 100Hz (50Hz mains) or
+// 120Hz (60Hz mains) ripple integrated over back to back 2.4ms cycles. The
+// test checks that the 50ms boxcar cancels the ripple, the decimation phase
+// (first output once the window is full, then every decimation samples),
+// that a saturated sample empties the window so the next output only
+// averages samples after the gap, and the IIR steady state and step
+// response. The exit status is non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725.c src/tcs34725_filter.c test/tcs34725_filter_test.c -lm -o tcs34725_filter_test
+
+#include <stdio.h>
+#include <math.h>
+#include "tcs34725.h"
+#include "tcs34725_filter.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+// 2.4ms integrations, 21 samples cover 50ms (50.4ms)
+#define IT          (TCS34725_INTEGRATIONTIME_2_4MS)
+#define PERIOD_S    (0.0024)
+#define WINDOW_MS   (50)
+#define TAPS        (21)
+#define PI          (3.14159265358979323846)
+
+static int failures;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        printf("line %d: %s failed\n", line, what);
+        failures++;
+    }
+}
+
+
+static tcs34725_color_t constant(uint16_t clear) {
+    tcs34725_color_t color = { (uint16_t)(clear / 4), (uint16_t)(clear / 3), (uint16_t)(clear / 5), clear };
+    return color;
+}
+
+
+static tcs34725_color_t ripple_sample(uint32_t k, double mean, double amplitude, double frequency) {
+    // Counts per cycle of mean + amplitude * sin(2 pi f t) integrated over cycle k
+    double w = 2.0 * PI * frequency;
+    double a = k * PERIOD_S;
+    double b = a + PERIOD_S;
+    double counts = mean + amplitude * (cos(w * a) - cos(w * b)) / (w * PERIOD_S);
+    return constant((uint16_t)lround(counts));
+}
+
+
+static void test_ripple(double frequency) {
+    tcs34725_filter_t filter;
+    tcs34725_color_t out;
+    CHECK(tcs34725_filter_init(&filter, IT, WINDOW_MS, 1, 0) == TCS34725_OK);
+    CHECK(filter.length == TAPS);
+
+    // Raw samples swing by +-50%, the boxcar output stays within 1% of the mean
+    const double mean = 400.0, amplitude = 200.0;
+    double raw_min = 65535, raw_max = 0, worst = 0;
+    uint32_t outputs = 0;
+    for(uint32_t k = 0; k < 2000; k++){
+        tcs34725_color_t sample = ripple_sample(k, mean, amplitude, frequency);
+        raw_min = fmin(raw_min, sample.clear);
+        raw_max = fmax(raw_max, sample.clear);
+        if(tcs34725_filter_push(&filter, sample, &out)){
+            outputs++;
+            worst = fmax(worst, fabs(out.clear - mean));
+        }
+    }
+    printf("%.0fHz ripple: raw %.0f-%.0f, filtered worst |error| %.1f counts\n", frequency, raw_min, raw_max, worst);
+    CHECK(raw_max - raw_min > mean / 2);
+    CHECK(worst <= mean / 100);
+    CHECK(outputs == 2000 - TAPS + 1);
+    CHECK(filter.rejected == 0);
+}
+
+
+static void test_decimation(void) {
+    tcs34725_filter_t filter;
+    tcs34725_color_t out;
+    CHECK(tcs34725_filter_init(&filter, IT, WINDOW_MS, 4, 0) == TCS34725_OK);
+
+    // Outputs on every 4th sample, the first one once 21 samples filled the window
+    for(uint32_t n = 1; n <= 60; n++){
+        bool ready = tcs34725_filter_push(&filter, constant(400), &out);
+        CHECK(ready == (n % 4 == 0 && n >= TAPS));
+        if(ready){
+            CHECK(out.clear == 400 && out.red == 100 && out.green == 133 && out.blue == 80);
+        }
+    }
+
+    // Invalid settings
+    CHECK(tcs34725_filter_init(&filter, IT, WINDOW_MS, 0, 0) == TCS34725_ERR_INVALID_ARG);
+    CHECK(tcs34725_filter_init(&filter, IT, 100, 1, 0) == TCS34725_ERR_INVALID_ARG);
+    CHECK(tcs34725_filter_init(&filter, IT, WINDOW_MS, 1, 17) == TCS34725_ERR_INVALID_ARG);
+}
+
+
+static void test_saturation_reset(void) {
+    tcs34725_filter_t filter;
+    tcs34725_color_t out;
+    CHECK(tcs34725_filter_init(&filter, IT, WINDOW_MS, 1, 0) == TCS34725_OK);
+    for(int i = 0; i < 30; i++){
+        tcs34725_filter_push(&filter, constant(100), &out);
+    }
+
+    // A saturated sample is dropped and starts the window over
+    CHECK(!tcs34725_filter_push(&filter, constant(tcs34725_calculate_saturation(IT)), &out));
+    CHECK(filter.rejected == 1 && filter.count == 0);
+
+    // No output until the window is full again, and none of it from before the gap
+    for(uint32_t n = 1; n <= TAPS; n++){
+        bool ready = tcs34725_filter_push(&filter, constant(500), &out);
+        CHECK(ready == (n == TAPS));
+    }
+    CHECK(out.clear == 500);
+}
+
+
+static void test_iir(void) {
+    tcs34725_filter_t filter;
+    tcs34725_color_t out;
+    CHECK(tcs34725_filter_init(&filter, IT, WINDOW_MS, 1, 2) == TCS34725_OK);
+
+    // Steady state equals the input
+    for(int i = 0; i < 100; i++){
+        if(tcs34725_filter_push(&filter, constant(400), &out)){
+            CHECK(out.clear == 400 && out.red == 100);
+        }
+    }
+
+    // Step: the output rises monotonically and settles on the new value
+    uint16_t last = 400;
+    for(int i = 0; i < 200; i++){
+        CHECK(tcs34725_filter_push(&filter, constant(600), &out));
+        CHECK(out.clear >= last && out.clear <= 600);
+        last = out.clear;
+    }
+    CHECK(out.clear == 600 && out.red == 150);
+
+    // Reset forgets the IIR state, the first output is the boxcar average
+    tcs34725_filter_reset(&filter);
+    for(uint32_t n = 1; n <= TAPS; n++){
+        bool ready = tcs34725_filter_push(&filter, constant(200), &out);
+        CHECK(ready == (n == TAPS));
+    }
+    CHECK(out.clear == 200);
+}
+
+
+int main(void) {
+    test_ripple(100.0);
+    test_ripple(120.0);
+    test_decimation();
+    test_saturation_reset();
+    test_iir();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
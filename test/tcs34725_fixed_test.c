@@ -0,0 +1,169 @@
+// Error bound test for the fixed point conversion helpers.
+//
+// Sweeps the 16-bit channel space and checks the integer only helpers
+// against the float formulas they replace, using the bounds documented
+// above tcs34725_calculate_normalized_RGB_fixed in src/tcs34725.c:
+//  - normalized RGB  |error| <= 0.002 for channels <= clear
+//  - lux             |error| <= 2 while the float result is in 0-65534
+//  - CCT (McCamy)    |error| <= 4K while the float result is in 1000K-20000K
+//
+// Every channel runs through all 65536 values while the other channels
+// step through a grid, followed by random samples. The worst error of each
+// helper is printed, the exit status is non-zero if a bound is exceeded.
+//
+// Build: cc -O2 -Iinc src/tcs34725.c test/tcs34725_fixed_test.c -lm -o tcs34725_fixed_test
+
+#include <stdio.h>
+#include <stdint.h>
+#include <math.h>
+#include "tcs34725.h"
+
+// Documented error bounds
+#define NORMALIZED_BOUND (0.002)
+#define LUX_BOUND        (2.0)
+#define CCT_BOUND        (4.0)
+
+// Grid spacing for the channels that are not swept
+#define GRID_STEP   (4096)
+// Random samples after the sweep
+#define RANDOM_SAMPLES (4000000UL)
+
+typedef struct {
+    const char* name;
+    double      bound;
+    double      worst;
+    uint64_t    checked;
+    uint64_t    failures;
+} bound_t;
+
+static bound_t normalized = {"normalized", NORMALIZED_BOUND, 0, 0, 0};
+static bound_t lux = {"lux", LUX_BOUND, 0, 0, 0};
+static bound_t cct = {"cct", CCT_BOUND, 0, 0, 0};
+
+static uint32_t rng_state = 0x12345678;
+
+
+static uint16_t random16(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (uint16_t)rng_state;
+}
+
+
+static void record(bound_t* b, double error, tcs34725_color_t color) {
+    error = fabs(error);
+    b->checked++;
+    if(error > b->worst){
+        b->worst = error;
+    }
+    if(error > b->bound){
+        if(b->failures < 10){
+            printf("%s: error %.4f at r=%u g=%u b=%u c=%u\n", b->name, error,
+                   color.red, color.green, color.blue, color.clear);
+        }
+        b->failures++;
+    }
+}
+
+
+/* Float references, same expressions as the float build of the driver but
+   without the uint16_t conversion so out of range results can be skipped */
+static float lux_float(tcs34725_color_t color) {
+    return (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+}
+
+
+static float cct_float(tcs34725_color_t color) {
+    float X = (-0.14282F * color.red) + (1.54924F * color.green) + (-0.95641F * color.blue);
+    float Y = (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+    float Z = (-0.68202F * color.red) + (0.77073F * color.green) + (0.56332F * color.blue);
+    float xc = (X) / (X + Y + Z);
+    float yc = (Y) / (X + Y + Z);
+    float n = (xc - 0.3320F) / (0.1858F - yc);
+    return (449.0F * powf(n, 3)) + (3525.0F * powf(n, 2)) + (6823.3F * n) + 5520.33F;
+}
+
+
+static void check_rgb(tcs34725_color_t color) {
+    float l = lux_float(color);
+    if(l >= 0.0F && l <= 65534.0F){
+        record(&lux, (double)tcs34725_calculate_lux_fixed(color) - l, color);
+    }
+
+    if(color.red == 0 && color.green == 0 && color.blue == 0){
+        return;
+    }
+    float c = cct_float(color);
+    if(c >= 1000.0F && c <= 20000.0F){
+        record(&cct, (double)tcs34725_calculate_color_temperature_fixed(color) - c, color);
+    }
+}
+
+
+static void check_normalized(uint16_t channel, uint16_t clear) {
+    tcs34725_color_t color = {channel, channel, channel, clear};
+    tcs34725_normalized_color_fixed_t fixed;
+    tcs34725_calculate_normalized_RGB_fixed(color, &fixed);
+    double expected = (double)channel / clear * 255.0;
+    record(&normalized, (double)fixed.red / (1 << TCS34725_FIXED_FRAC_BITS) - expected, color);
+}
+
+
+static bool report(const bound_t* b) {
+    printf("%-10s checked %llu, worst |error| %.4f (bound %.4f), %llu failures\n", b->name,
+           (unsigned long long)b->checked, b->worst, b->bound, (unsigned long long)b->failures);
+    return b->failures == 0;
+}
+
+
+int main(void) {
+    // Normalized RGB: every clear value, channels <= clear with a small stride plus the end point
+    for(uint32_t clear = 1; clear <= 0xFFFF; clear++){
+        for(uint32_t channel = 0; channel < clear; channel += 37){
+            check_normalized((uint16_t)channel, (uint16_t)clear);
+        }
+        check_normalized((uint16_t)clear, (uint16_t)clear);
+    }
+
+    // Lux and CCT: sweep each channel over the full range, the other two on the grid
+    for(uint32_t swept = 0; swept < 3; swept++){
+        for(uint32_t v = 0; v <= 0xFFFF; v++){
+            for(uint32_t a = 0; a <= 0x10000; a += GRID_STEP){
+                for(uint32_t b = 0; b <= 0x10000; b += GRID_STEP){
+                    uint16_t ga = (a > 0xFFFF) ? 0xFFFF : (uint16_t)a;
+                    uint16_t gb = (b > 0xFFFF) ? 0xFFFF : (uint16_t)b;
+                    tcs34725_color_t color = {0, 0, 0, 0};
+                    if(swept == 0){
+                        color.red = (uint16_t)v; color.green = ga; color.blue = gb;
+                    }else if(swept == 1){
+                        color.red = ga; color.green = (uint16_t)v; color.blue = gb;
+                    }else{
+                        color.red = ga; color.green = gb; color.blue = (uint16_t)v;
+                    }
+                    check_rgb(color);
+                }
+            }
+        }
+    }
+
+    for(unsigned long i = 0; i < RANDOM_SAMPLES; i++){
+        tcs34725_color_t color = {0, 0, 0, 0};
+        color.red = random16();
+        color.green = random16();
+        color.blue = random16();
+        color.clear = random16();
+        check_rgb(color);
+        if(color.clear > 0){
+            check_normalized((color.red <= color.clear) ? color.red : color.clear, color.clear);
+        }
+    }
+
+    bool ok = true;
+    ok &= report(&normalized);
+    ok &= report(&lux);
+    ok &= report(&cct);
+    printf("%s\n", ok ? "PASS" : "FAIL");
+    return ok ? 0 : 1;
+}
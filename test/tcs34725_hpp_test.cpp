@@ -0,0 +1,104 @@
+// Test of the C++ front end against the simulator.
+//
+// Sensor is instantiated with a bus that forwards complete command bytes
+// to the simulator (tcs34725_sim.h), once for every integration time. The
+// test checks that init is followed by a valid sample (the integration
+// delay covers the real 2.4ms cycles), that sample waits for a new
+// integration, and the compile-time scale factors. The exit status is
+// non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc -c src/tcs34725.c src/tcs34725_sim.c && c++ -std=c++11 -O2 -Iinc tcs34725.o tcs34725_sim.o test/tcs34725_hpp_test.cpp -lm -o tcs34725_hpp_test
+
+#include <stdio.h>
+#include <math.h>
+#include "tcs34725.hpp"
+#include "tcs34725_sim.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static tcs34725_sim_t sim;
+static int failures;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        printf("line %d: %s failed\n", line, what);
+        failures++;
+    }
+}
+
+
+// Bus sending complete command bytes, as a platform specific bus would
+class SimBus {
+public:
+    int8_t read(uint8_t command, uint8_t* data, uint32_t len) {
+        return tcs34725_sim_read_reg(command, data, len, &sim);
+    }
+    int8_t write(uint8_t command, const uint8_t* data, uint32_t len) {
+        if (len == 0) {
+            return tcs34725_sim_write_byte(command, &sim);
+        }
+        return tcs34725_sim_write_reg(command, data, len, &sim);
+    }
+    void delay_ms(uint32_t period) {
+        tcs34725_sim_delay_ms(period);
+    }
+};
+
+
+template <tcs34725_integration_time_t IT, tcs34725_gain_t Gain>
+static void test_sensor(uint32_t gain) {
+    typedef tcs34725::Sensor<SimBus, IT, Gain> sensor_t;
+    static tcs34725_config_t clock;
+
+    // The simulator only needs a config to join the virtual clock
+    tcs34725_sim_detach_all();
+    tcs34725_sim_init(&sim, TCS34725_ID);
+    tcs34725_sim_set_light(&sim, tcs34725_sim_light_t{ 1.0F, 2.0F, 3.0F, 6.0F });
+    CHECK(tcs34725_sim_attach(&sim, &clock) == TCS34725_OK);
+
+    SimBus bus;
+    sensor_t sensor(bus);
+    const uint32_t cycles = 256 - static_cast<uint32_t>(IT);
+    const uint16_t clear = static_cast<uint16_t>(6 * cycles * gain);
+
+    // The first integration is complete when init returns
+    tcs34725_color_t color = { 0, 0, 0, 0 };
+    uint8_t status = 0;
+    CHECK(sensor.init() == TCS34725_OK);
+    CHECK(sensor.read(color, &status) == TCS34725_OK);
+    CHECK(status & TCS34727_FLAG_AVALID);
+    CHECK(color.clear == clear && color.red == cycles * gain);
+    CHECK(color.green == 2 * cycles * gain && color.blue == 3 * cycles * gain);
+
+    // Every sample call waits for a new integration
+    for(int i = 0; i < 3; i++){
+        uint32_t before = sim.cycles;
+        CHECK(sensor.sample(color) == TCS34725_OK);
+        CHECK(sim.cycles > before);
+        CHECK(color.clear == clear);
+    }
+
+    CHECK(sensor_t::integration_delay_ms * 10 >= cycles * 24);
+    CHECK(!sensor_t::saturated(color));
+    CHECK(fabsf(sensor_t::normalized_clear(color) - 6.0F) < 1e-4F);
+    float lux = (-0.32466F * 1.0F) + (1.57837F * 2.0F) + (-0.73191F * 3.0F);
+    CHECK(fabsf(sensor_t::normalized_lux(color) - lux) <= 1.0F / static_cast<float>(cycles * gain));
+
+    CHECK(sensor.disable() == TCS34725_OK);
+    CHECK(sim.regs[TCS34725_ENABLE_REG] == 0);
+}
+
+
+int main(void) {
+    test_sensor<TCS34725_INTEGRATIONTIME_2_4MS, TCS34725_GAIN_1X>(1);
+    test_sensor<TCS34725_INTEGRATIONTIME_24MS, TCS34725_GAIN_1X>(1);
+    test_sensor<TCS34725_INTEGRATIONTIME_50MS, TCS34725_GAIN_1X>(1);
+    test_sensor<TCS34725_INTEGRATIONTIME_101MS, TCS34725_GAIN_1X>(1);
+    test_sensor<TCS34725_INTEGRATIONTIME_154MS, TCS34725_GAIN_1X>(1);
+    test_sensor<TCS34725_INTEGRATIONTIME_700MS, TCS34725_GAIN_1X>(1);
+    test_sensor<TCS34725_INTEGRATIONTIME_50MS, TCS34725_GAIN_4X>(4);
+    test_sensor<TCS34725_INTEGRATIONTIME_101MS, TCS34725_GAIN_16X>(16);
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,221 @@
+// Test of the Linux userspace backend against a fake ioctl.
+//
+// The fake decodes I2C_RDWR and I2C_SMBUS requests and forwards them to the
+// simulator (tcs34725_sim.h), so the backend runs without /dev/i2c-N. It
+// checks the syscall counts of combined reads and batched writes, that
+// queued writes go out before a delay, and that a failed queued write is
+// reported and invalidates the register shadow. The exit status is
+// non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725.c src/tcs34725_sim.c src/tcs34725_linux_i2c.c test/tcs34725_linux_i2c_test.c -lm -o tcs34725_linux_i2c_test
+
+#include <stdio.h>
+#include <linux/i2c-dev.h>
+#include "tcs34725.h"
+#include "tcs34725_sim.h"
+#include "tcs34725_linux_i2c.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static tcs34725_sim_t sim;
+static bool smbus_only;
+static uint32_t fail_next;     // Number of upcoming ioctls that fail
+static uint64_t pon_us;        // Virtual time of the last ENABLE = PON write
+static uint64_t aen_us;        // Virtual time of the last ENABLE = PON | AEN write
+static int failures;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        printf("line %d: %s failed\n", line, what);
+        failures++;
+    }
+}
+
+
+static void record_enable(uint8_t command, const uint8_t* data, uint32_t len) {
+    if(len > 0 && (command & 0x1F) == TCS34725_ENABLE_REG){
+        uint8_t value = data[0] & (TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+        if(value == TCS34725_ENABLE_PON){
+            pon_us = sim.time_us;
+        }else if(value == (TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN)){
+            aen_us = sim.time_us;
+        }
+    }
+}
+
+
+static int fake_ioctl(int fd, unsigned long request, void* arg) {
+    (void)fd;
+    if(request == I2C_FUNCS){
+        *(unsigned long*)arg = smbus_only ? (I2C_FUNC_SMBUS_I2C_BLOCK | I2C_FUNC_SMBUS_BYTE) : I2C_FUNC_I2C;
+        return 0;
+    }
+    if(request == I2C_SLAVE){
+        return 0;
+    }
+    if(fail_next > 0){
+        fail_next--;
+        return -1;
+    }
+
+    if(request == I2C_RDWR){
+        struct i2c_rdwr_ioctl_data* rdwr = (struct i2c_rdwr_ioctl_data*)arg;
+        for(uint32_t i = 0; i < rdwr->nmsgs; i++){
+            struct i2c_msg* msg = &rdwr->msgs[i];
+            if(i + 1 < rdwr->nmsgs && (rdwr->msgs[i + 1].flags & I2C_M_RD)){
+                // Command byte followed by a read (repeated start)
+                if(tcs34725_sim_read_reg(msg->buf[0], rdwr->msgs[i + 1].buf, rdwr->msgs[i + 1].len, &sim) != 0){
+                    return -1;
+                }
+                i++;
+            }else if(msg->len == 1){
+                if(tcs34725_sim_write_byte(msg->buf[0], &sim) != 0){
+                    return -1;
+                }
+            }else{
+                record_enable(msg->buf[0], &msg->buf[1], msg->len - 1);
+                if(tcs34725_sim_write_reg(msg->buf[0], &msg->buf[1], msg->len - 1, &sim) != 0){
+                    return -1;
+                }
+            }
+        }
+        return (int)rdwr->nmsgs;
+    }
+    if(request == I2C_SMBUS){
+        struct i2c_smbus_ioctl_data* smbus = (struct i2c_smbus_ioctl_data*)arg;
+        if(smbus->size == I2C_SMBUS_BYTE){
+            return tcs34725_sim_write_byte(smbus->command, &sim);
+        }
+        if(smbus->read_write == I2C_SMBUS_READ){
+            return tcs34725_sim_read_reg(smbus->command, &smbus->data->block[1], smbus->data->block[0], &sim);
+        }
+        record_enable(smbus->command, &smbus->data->block[1], smbus->data->block[0]);
+        return tcs34725_sim_write_reg(smbus->command, &smbus->data->block[1], smbus->data->block[0], &sim);
+    }
+    return -1;
+}
+
+
+static void delay_ms(uint32_t period) {
+    // The backend delay flushes the queued writes, the simulator provides the time
+    tcs34725_linux_i2c_delay_ms(0);
+    tcs34725_sim_delay_ms(period);
+}
+
+
+static void setup(tcs34725_linux_i2c_t* dev, tcs34725_config_t* config, bool smbus) {
+    static tcs34725_config_t clock;
+
+    smbus_only = smbus;
+    fail_next = 0;
+    tcs34725_sim_detach_all();
+    tcs34725_sim_init(&sim, TCS34725_ID);
+    tcs34725_sim_set_light(&sim, (tcs34725_sim_light_t){ .red = 10.0F, .green = 20.0F, .blue = 30.0F, .clear = 60.0F });
+    // The simulator only provides the virtual clock, the bus goes through the backend
+    CHECK(tcs34725_sim_attach(&sim, &clock) == TCS34725_OK);
+
+    *dev = (tcs34725_linux_i2c_t){ .ioctl_fn = fake_ioctl };
+    *config = (tcs34725_config_t){ 0 };
+    CHECK(tcs34725_linux_i2c_open(dev, "/dev/null", TCS34725_ADDRESS) == TCS34725_OK);
+    CHECK(dev->smbus == smbus);
+    tcs34725_linux_i2c_attach(dev, config);
+    config->delay_ms = delay_ms;
+    config->get_tick_ms = tcs34725_sim_get_tick_ms;
+    config->settings.integration_time = TCS34725_INTEGRATIONTIME_24MS;
+    config->settings.gain = TCS34725_GAIN_1X;
+}
+
+
+static void test_reads(bool smbus) {
+    tcs34725_linux_i2c_t dev;
+    tcs34725_config_t config;
+    setup(&dev, &config, smbus);
+
+    // ID read, ATIME, CONTROL and two ENABLE writes
+    uint32_t before = dev.syscalls;
+    CHECK(tcs34725_init(&config) == TCS34725_OK);
+    CHECK(dev.syscalls - before == 5);
+
+    // Status and data in one combined transaction
+    tcs34725_color_t color;
+    uint8_t status = 0;
+    before = dev.syscalls;
+    CHECK(tcs34725_get_raw_data_burst(&color, &status, &config) == TCS34725_OK);
+    CHECK(dev.syscalls - before == 1);
+    CHECK(status & TCS34727_FLAG_AVALID);
+    CHECK(color.clear == 600 && color.red == 100 && color.green == 200 && color.blue == 300);
+
+    tcs34725_linux_i2c_close(&dev);
+}
+
+
+static void test_batching(void) {
+    tcs34725_linux_i2c_t dev;
+    tcs34725_config_t config;
+    setup(&dev, &config, false);
+    CHECK(tcs34725_init(&config) == TCS34725_OK);
+
+    // Writes are held back until end
+    tcs34725_linux_i2c_begin(&dev);
+    uint32_t before = dev.syscalls;
+    CHECK(tcs34725_set_gain(TCS34725_GAIN_4X, &config) == TCS34725_OK);
+    CHECK(tcs34725_set_int_limits(10, 1000, &config) == TCS34725_OK);
+    CHECK(tcs34725_clear_interrupt(&config) == TCS34725_OK);
+    CHECK(dev.syscalls == before);
+    CHECK(tcs34725_linux_i2c_end(&dev) == 0);
+    CHECK(dev.syscalls - before == 1);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_4X);
+    CHECK(sim.regs[TCS34725_AILTL_REG] == 10 && sim.regs[TCS34725_AIHTL_REG] == (1000 & 0xFF));
+
+    // A delay sends the queued writes first, so the PON warm-up is kept
+    tcs34725_linux_i2c_begin(&dev);
+    CHECK(tcs34725_disable(&config) == TCS34725_OK);
+    CHECK(tcs34725_enable(&config) == TCS34725_OK);
+    CHECK(tcs34725_linux_i2c_end(&dev) == 0);
+    CHECK(aen_us >= pon_us + 3000);
+
+    tcs34725_linux_i2c_close(&dev);
+}
+
+
+static void test_errors(void) {
+    tcs34725_linux_i2c_t dev;
+    tcs34725_config_t config;
+    setup(&dev, &config, false);
+    CHECK(tcs34725_init(&config) == TCS34725_OK);
+
+    // Failure reported by end, the shadow no longer trusts the lost write
+    tcs34725_linux_i2c_begin(&dev);
+    CHECK(tcs34725_set_gain(TCS34725_GAIN_16X, &config) == TCS34725_OK);
+    fail_next = 1;
+    CHECK(tcs34725_linux_i2c_end(&dev) != 0);
+    CHECK(config.state.shadow_valid == 0);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_1X);
+    CHECK(tcs34725_set_gain(TCS34725_GAIN_16X, &config) == TCS34725_OK);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_16X);
+
+    // Failure while flushing for a delay, reported by the next call
+    tcs34725_linux_i2c_begin(&dev);
+    CHECK(tcs34725_set_gain(TCS34725_GAIN_60X, &config) == TCS34725_OK);
+    fail_next = 1;
+    config.delay_ms(1);
+    CHECK(config.state.shadow_valid == 0);
+    tcs34725_color_t color;
+    uint8_t status;
+    CHECK(tcs34725_get_raw_data_burst(&color, &status, &config) == TCS34725_ERR_READ);
+    CHECK(tcs34725_get_raw_data_burst(&color, &status, &config) == TCS34725_OK);
+    CHECK(tcs34725_linux_i2c_end(&dev) == 0);
+
+    tcs34725_linux_i2c_close(&dev);
+}
+
+
+int main(void) {
+    test_reads(false);
+    test_reads(true);
+    test_batching();
+    test_errors();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
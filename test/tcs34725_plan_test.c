@@ -0,0 +1,190 @@
+// Error bound test for the conversion plans.
+//
+// Checks the figures documented in tcs34725_plan.h:
+//  - CCT table interpolation against the cubic, swept over the whole table
+//    range: 14K with 16 entries, 3K with 32, 1K from 64 on
+//  - folded McCamy rows (no table, no calibration) against
+//    tcs34725_calculate_color_temperature within 1K over the table range
+//  - DN40, lux and the saturation threshold identical to the scalar versions
+//    for every integration time, an identity calibration changes nothing
+// With TCS34725_FIXED_POINT the scalar lux and McCamy CCT use the integer
+// paths, so the float formulas they replace are used as the reference
+// instead. The worst errors are printed, the exit status is non-zero if a
+// bound is exceeded.
+//
+// Build: cc -O2 -Iinc src/tcs34725.c src/tcs34725_plan.c test/tcs34725_plan_test.c -lm -o tcs34725_plan_test
+
+#include <stdio.h>
+#include <math.h>
+#include "tcs34725.h"
+#include "tcs34725_plan.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+// Points of the n sweep over the table range
+#define N_STEPS (200000)
+// Random samples
+#define RANDOM_SAMPLES (2000000UL)
+
+static uint32_t rng_state = 0x13579BDF;
+static int failures;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        if(failures < 20){
+            printf("line %d: %s failed\n", line, what);
+        }
+        failures++;
+    }
+}
+
+
+static uint16_t random16(void) {
+    // xorshift32
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 17;
+    rng_state ^= rng_state << 5;
+    return (uint16_t)rng_state;
+}
+
+
+static tcs34725_color_t random_color(void) {
+    tcs34725_color_t color = { random16(), random16(), random16(), random16() };
+    // Spread the channel ratios, so that the whole table range is reached
+    color.red >>= random16() % 12;
+    color.green >>= random16() % 12;
+    color.blue >>= random16() % 12;
+    return color;
+}
+
+
+static uint16_t scalar_lux(tcs34725_color_t color) {
+#ifdef TCS34725_FIXED_POINT
+    return (uint16_t)((-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue));
+#else
+    return tcs34725_calculate_lux(color);
+#endif
+}
+
+
+static uint16_t scalar_cct(tcs34725_color_t color) {
+#ifdef TCS34725_FIXED_POINT
+    float X = (-0.14282F * color.red) + (1.54924F * color.green) + (-0.95641F * color.blue);
+    float Y = (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+    float Z = (-0.68202F * color.red) + (0.77073F * color.green) + (0.56332F * color.blue);
+    float xc = (X) / (X + Y + Z);
+    float yc = (Y) / (X + Y + Z);
+    float n = (xc - 0.3320F) / (0.1858F - yc);
+    return (uint16_t)((449.0F * powf(n, 3)) + (3525.0F * powf(n, 2)) + (6823.3F * n) + 5520.33F);
+#else
+    return tcs34725_calculate_color_temperature(color);
+#endif
+}
+
+
+static void test_table(uint16_t size, double bound) {
+    static uint16_t table[256];
+    const tcs34725_settings_t settings = { TCS34725_GAIN_1X, TCS34725_INTEGRATIONTIME_50MS };
+    tcs34725_plan_t cubic, lookup;
+    CHECK(tcs34725_plan_init(&cubic, settings, NULL, NULL, 0) == TCS34725_OK);
+    CHECK(tcs34725_plan_init(&lookup, settings, NULL, table, size) == TCS34725_OK);
+
+    /* Rows that make n equal to the red channel scale (num = n * red,
+       den = red), so n can be swept directly over the table range */
+    double worst = 0;
+    for(uint32_t step = 0; step < N_STEPS; step++){
+        float n = TCS34725_PLAN_N_MIN + (TCS34725_PLAN_N_MAX - TCS34725_PLAN_N_MIN) * (float)step / N_STEPS;
+        const tcs34725_color_t color = { 1, 0, 0, 0 };
+        cubic.num[0] = n;
+        cubic.den[0] = 1.0F;
+        cubic.num[1] = cubic.num[2] = cubic.den[1] = cubic.den[2] = 0.0F;
+        lookup.num[0] = n;
+        lookup.den[0] = 1.0F;
+        lookup.num[1] = lookup.num[2] = lookup.den[1] = lookup.den[2] = 0.0F;
+        double error = fabs((double)tcs34725_plan_color_temperature(&lookup, color) - tcs34725_plan_color_temperature(&cubic, color));
+        if(error > worst){
+            worst = error;
+        }
+    }
+    printf("table %3u entries: worst |error| %.0fK (bound %.0fK)\n", size, worst, bound);
+    CHECK(worst <= bound);
+}
+
+
+static void test_folded(void) {
+    const tcs34725_settings_t settings = { TCS34725_GAIN_1X, TCS34725_INTEGRATIONTIME_50MS };
+    tcs34725_plan_t plan;
+    CHECK(tcs34725_plan_init(&plan, settings, NULL, NULL, 0) == TCS34725_OK);
+
+    double worst = 0;
+    unsigned long in_range = 0;
+    for(unsigned long i = 0; i < RANDOM_SAMPLES; i++){
+        tcs34725_color_t color = random_color();
+        float num = plan.num[0] * color.red + plan.num[1] * color.green + plan.num[2] * color.blue;
+        float den = plan.den[0] * color.red + plan.den[1] * color.green + plan.den[2] * color.blue;
+        if(den == 0.0F){
+            continue;
+        }
+        float n = num / den;
+        if(n < TCS34725_PLAN_N_MIN || n >= TCS34725_PLAN_N_MAX){
+            continue;
+        }
+        in_range++;
+        double error = fabs((double)tcs34725_plan_color_temperature(&plan, color) - scalar_cct(color));
+        if(error > worst){
+            worst = error;
+        }
+    }
+    printf("folded McCamy: %lu samples in range, worst |error| %.0fK (bound 1K)\n", in_range, worst);
+    CHECK(in_range > RANDOM_SAMPLES / 4);
+    CHECK(worst <= 1.0);
+}
+
+
+static void test_exact(void) {
+    const tcs34725_integration_time_t times[] = {
+        TCS34725_INTEGRATIONTIME_2_4MS, TCS34725_INTEGRATIONTIME_24MS, TCS34725_INTEGRATIONTIME_50MS,
+        TCS34725_INTEGRATIONTIME_101MS, TCS34725_INTEGRATIONTIME_154MS, TCS34725_INTEGRATIONTIME_700MS,
+    };
+    const float identity[9] = { 1, 0, 0, 0, 1, 0, 0, 0, 1 };
+    static uint16_t table[64];
+    tcs34725_config_t config = { 0 };
+
+    for(size_t t = 0; t < sizeof(times) / sizeof(times[0]); t++){
+        const tcs34725_settings_t settings = { TCS34725_GAIN_16X, times[t] };
+        tcs34725_plan_t plan, calibrated;
+        CHECK(tcs34725_plan_init(&plan, settings, NULL, table, 64) == TCS34725_OK);
+        CHECK(tcs34725_plan_init(&calibrated, settings, identity, NULL, 0) == TCS34725_OK);
+        config.settings = settings;
+        CHECK(plan.saturation == tcs34725_calculate_saturation(times[t]));
+
+        for(unsigned long i = 0; i < RANDOM_SAMPLES / 8; i++){
+            tcs34725_color_t color = random_color();
+            CHECK(tcs34725_plan_color_temperature_dn40(&plan, color) == tcs34725_calculate_color_temperature_dn40(color, &config));
+            CHECK(tcs34725_plan_saturated(&plan, color) == (color.clear >= tcs34725_calculate_saturation(times[t])));
+            float lux = (-0.32466F * color.red) + (1.57837F * color.green) + (-0.73191F * color.blue);
+            if(lux >= 0.0F && lux < 65535.0F){
+                CHECK(tcs34725_plan_lux(&plan, color) == scalar_lux(color));
+            }
+            CHECK(tcs34725_plan_lux(&calibrated, color) == tcs34725_plan_lux(&plan, color));
+        }
+    }
+
+    // Table storage needs at least two entries
+    tcs34725_plan_t plan;
+    const tcs34725_settings_t settings = { TCS34725_GAIN_1X, TCS34725_INTEGRATIONTIME_50MS };
+    CHECK(tcs34725_plan_init(&plan, settings, NULL, table, 1) == TCS34725_ERR_INVALID_ARG);
+}
+
+
+int main(void) {
+    test_table(16, 14.0);
+    test_table(32, 3.0);
+    test_table(64, 1.0);
+    test_table(256, 1.0);
+    test_folded();
+    test_exact();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,318 @@
+// Test of the multi-sensor scheduler.
+//
+// Five simulated sensors with different integration times and light levels
+// sit on two buses, four of them behind a mux on bus 0. The bus callbacks
+// check that the mux is switched to a sensor's channel before every
+// transaction with it, and count redundant channel selects. The test
+// checks the (bus, channel) service order, that the integrations of all
+// sensors overlap (a batch takes about the longest integration, not the
+// sum), the results of every sensor, free running batches, and the
+// timeout and mux failure paths leaving the other sensors unaffected.
+// The exit status is non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725.c src/tcs34725_sim.c src/tcs34725_sched.c test/tcs34725_sched_test.c -lm -o tcs34725_sched_test
+
+#include <stdio.h>
+#include "tcs34725.h"
+#include "tcs34725_sim.h"
+#include "tcs34725_sched.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+#define SENSORS (5)
+#define BUSES   (2)
+
+// Sensor behind a mux channel
+typedef struct {
+    tcs34725_sim_t sim;
+    uint8_t        bus;
+    uint8_t        channel;
+    bool           dead;       // STATUS never reports AVALID
+    bool           accessed;   // Seen on the bus in the current batch
+} device_t;
+
+// Mux of one bus
+typedef struct {
+    int16_t channel;           // Channel the mux is switched to (-1 = none)
+    int16_t broken;            // Channel whose select fails (-1 = none)
+} mux_t;
+
+static device_t devices[SENSORS];
+static tcs34725_config_t configs[SENSORS];
+static tcs34725_sched_sensor_t sensors[SENSORS];
+static tcs34725_bus_t buses[BUSES];
+static uint16_t order[SENSORS];
+static mux_t mux;
+
+static size_t access_log[SENSORS];   // Sensors in order of their first bus transaction of a batch
+static size_t access_count;
+static unsigned wrong_channel, redundant_selects;
+
+static int failures;
+
+// Sensors listed out of (bus, channel) order, bus 1 has no mux
+static const uint8_t sensor_bus[SENSORS] = { 1, 0, 0, 0, 0 };
+static const uint8_t sensor_channel[SENSORS] = { 0, 5, 0, 3, 1 };
+static const tcs34725_integration_time_t sensor_it[SENSORS] = {
+    TCS34725_INTEGRATIONTIME_50MS, TCS34725_INTEGRATIONTIME_24MS, TCS34725_INTEGRATIONTIME_154MS,
+    TCS34725_INTEGRATIONTIME_2_4MS, TCS34725_INTEGRATIONTIME_101MS,
+};
+// Service order: (0, 0), (0, 1), (0, 3), (0, 5), (1, 0)
+static const size_t sorted[SENSORS] = { 2, 4, 3, 1, 0 };
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        printf("line %d: %s failed\n", line, what);
+        failures++;
+    }
+}
+
+
+static bool selected(device_t* device) {
+    // Every transaction must reach the intended sensor
+    if(device->bus == 0 && mux.channel != device->channel){
+        wrong_channel++;
+        return false;
+    }
+    if(!device->accessed){
+        device->accessed = true;
+        access_log[access_count++] = (size_t)(device - devices);
+    }
+    return true;
+}
+
+
+static int8_t bus_read(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    device_t* device = (device_t*)user_ptr;
+    if(!selected(device)){
+        return -1;
+    }
+    int8_t rslt = tcs34725_sim_read_reg(reg_addr, reg_data, len, &device->sim);
+    uint8_t reg = reg_addr & 0x1F;
+    if(rslt == 0 && device->dead && reg <= TCS34725_STATUS_REG && reg + len > TCS34725_STATUS_REG){
+        reg_data[TCS34725_STATUS_REG - reg] &= (uint8_t)~TCS34727_FLAG_AVALID;
+    }
+    return rslt;
+}
+
+
+static int8_t bus_write(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    device_t* device = (device_t*)user_ptr;
+    return selected(device) ? tcs34725_sim_write_reg(reg_addr, reg_data, len, &device->sim) : -1;
+}
+
+
+static int8_t bus_write_byte(uint8_t single_byte, void* user_ptr) {
+    device_t* device = (device_t*)user_ptr;
+    return selected(device) ? tcs34725_sim_write_byte(single_byte, &device->sim) : -1;
+}
+
+
+static int8_t mux_select(uint8_t channel, void* user_ptr) {
+    mux_t* m = (mux_t*)user_ptr;
+    if(m->channel == channel){
+        redundant_selects++;
+    }
+    if(m->broken == channel){
+        m->channel = -1;
+        return -1;
+    }
+    m->channel = channel;
+    return 0;
+}
+
+
+static uint32_t integration_ms(tcs34725_integration_time_t it) {
+    return ((256 - (uint32_t)it) * 24 + 9) / 10;
+}
+
+
+static void setup(tcs34725_sched_t* sched, bool free_running) {
+    tcs34725_sim_detach_all();
+    mux = (mux_t){ -1, -1 };
+    buses[0] = (tcs34725_bus_t){ mux_select, &mux, -1 };
+    buses[1] = (tcs34725_bus_t){ NULL, NULL, -1 };
+
+    for(size_t i = 0; i < SENSORS; i++){
+        device_t* device = &devices[i];
+        tcs34725_sim_init(&device->sim, TCS34725_ID);
+        // Distinct light per sensor, so that results cannot be mixed up
+        tcs34725_sim_set_light(&device->sim, (tcs34725_sim_light_t){ .red = 1.0F, .green = 2.0F, .blue = 3.0F, .clear = 5.0F + i });
+        device->bus = sensor_bus[i];
+        device->channel = sensor_channel[i];
+        device->dead = false;
+
+        configs[i] = (tcs34725_config_t){ 0 };
+        CHECK(tcs34725_sim_attach(&device->sim, &configs[i]) == TCS34725_OK);
+        configs[i].read_reg = bus_read;
+        configs[i].write_reg = bus_write;
+        configs[i].write_byte = bus_write_byte;
+        configs[i].user_ptr = device;
+        configs[i].settings.integration_time = sensor_it[i];
+        configs[i].settings.gain = TCS34725_GAIN_1X;
+        if(device->bus == 0){
+            mux.channel = device->channel;
+        }
+        CHECK(tcs34725_init(&configs[i]) == TCS34725_OK);
+
+        sensors[i] = (tcs34725_sched_sensor_t){ .config = &configs[i], .bus = device->bus, .channel = device->channel };
+    }
+    // The scheduler starts without knowing the mux state
+    mux.channel = -1;
+
+    *sched = (tcs34725_sched_t){
+        .buses = buses, .bus_count = BUSES, .sensors = sensors, .sensor_count = SENSORS,
+        .order = order, .delay_ms = tcs34725_sim_delay_ms, .free_running = free_running,
+    };
+    CHECK(tcs34725_sched_init(sched) == TCS34725_OK);
+}
+
+
+static uint32_t run(tcs34725_sched_t* sched, tcs34725_err_t* err) {
+    // One batch, returns its duration
+    for(size_t i = 0; i < SENSORS; i++){
+        devices[i].accessed = false;
+    }
+    access_count = 0;
+    wrong_channel = 0;
+    redundant_selects = 0;
+    uint32_t start = tcs34725_sim_get_tick_ms();
+    *err = tcs34725_sched_run(sched);
+    return tcs34725_sim_get_tick_ms() - start;
+}
+
+
+static bool result_ok(size_t i) {
+    // Clear counts of a full integration of sensor i
+    return sensors[i].err == TCS34725_OK && sensors[i].color.clear == (uint16_t)((5 + i) * (256 - (uint32_t)sensor_it[i]));
+}
+
+
+static void test_order_and_overlap(void) {
+    tcs34725_sched_t sched;
+    tcs34725_err_t err;
+    setup(&sched, false);
+
+    // Service order
+    for(size_t i = 0; i < SENSORS; i++){
+        CHECK(order[i] == sorted[i]);
+    }
+
+    uint32_t longest = 0, sum = 0;
+    for(size_t i = 0; i < SENSORS; i++){
+        longest = (integration_ms(sensor_it[i]) > longest) ? integration_ms(sensor_it[i]) : longest;
+        sum += integration_ms(sensor_it[i]);
+    }
+
+    for(int batch = 0; batch < 3; batch++){
+        uint32_t elapsed = run(&sched, &err);
+        printf("batch %d: %ums (longest integration %ums, all %ums), %u mux switches\n", batch, elapsed, longest, sum, sched.mux_switches);
+        CHECK(err == TCS34725_OK);
+        for(size_t i = 0; i < SENSORS; i++){
+            CHECK(result_ok(i));
+            // Powered down between batches
+            CHECK(devices[i].sim.phase == TCS34725_SIM_SLEEP);
+        }
+
+        // Started in (bus, channel) order, on the right channel, no needless selects
+        CHECK(access_count == SENSORS);
+        for(size_t i = 0; i < access_count; i++){
+            CHECK(access_log[i] == sorted[i]);
+        }
+        CHECK(wrong_channel == 0);
+        CHECK(redundant_selects == 0);
+
+        // Overlapping: warm-up, the longest integration and polling slack
+        CHECK(elapsed >= longest);
+        CHECK(elapsed <= 3 + longest + 5);
+        CHECK(elapsed < sum);
+    }
+}
+
+
+static void test_free_running(void) {
+    tcs34725_sched_t sched;
+    tcs34725_err_t err;
+    setup(&sched, true);
+
+    // Sensors keep integrating between batches and are not restarted
+    for(int batch = 0; batch < 3; batch++){
+        run(&sched, &err);
+        CHECK(err == TCS34725_OK);
+        for(size_t i = 0; i < SENSORS; i++){
+            CHECK(result_ok(i));
+            CHECK(devices[i].sim.phase != TCS34725_SIM_SLEEP);
+        }
+        CHECK(wrong_channel == 0);
+        CHECK(redundant_selects == 0);
+    }
+}
+
+
+static void test_timeout(void) {
+    tcs34725_sched_t sched;
+    tcs34725_err_t err;
+    setup(&sched, false);
+
+    // The sensor with the longest integration never reports AVALID
+    const size_t dead = 2;
+    devices[dead].dead = true;
+    uint32_t limit = 3 + 2 * integration_ms(sensor_it[dead]) + 20;
+
+    uint32_t elapsed = run(&sched, &err);
+    printf("timeout: given up after %ums (limit %ums)\n", elapsed, limit);
+    CHECK(err != TCS34725_OK);
+    CHECK(sensors[dead].err == TCS34725_ERR_NOT_READY);
+    CHECK(elapsed > limit && elapsed <= limit + 3);
+    for(size_t i = 0; i < SENSORS; i++){
+        if(i != dead){
+            CHECK(result_ok(i));
+        }
+        CHECK(devices[i].sim.phase == TCS34725_SIM_SLEEP);
+    }
+    CHECK(wrong_channel == 0);
+
+    // Recovers on the next batch
+    devices[dead].dead = false;
+    run(&sched, &err);
+    CHECK(err == TCS34725_OK);
+    CHECK(result_ok(dead));
+}
+
+
+static void test_mux_failure(void) {
+    tcs34725_sched_t sched;
+    tcs34725_err_t err;
+    setup(&sched, false);
+
+    // Channel 3 cannot be selected: that sensor fails, nothing is sent on the wrong channel
+    mux.broken = 3;
+    run(&sched, &err);
+    CHECK(err != TCS34725_OK);
+    CHECK(sensors[3].err == TCS34725_ERR_WRITE);
+    CHECK(!devices[3].accessed);
+    CHECK(wrong_channel == 0);
+    for(size_t i = 0; i < SENSORS; i++){
+        if(i != 3){
+            CHECK(result_ok(i));
+        }
+    }
+
+    // Invalid sensor lists
+    sensors[1].bus = BUSES;
+    CHECK(tcs34725_sched_init(&sched) == TCS34725_ERR_INVALID_ARG);
+    sensors[1].bus = 0;
+    configs[1].get_tick_ms = NULL;
+    CHECK(tcs34725_sched_init(&sched) == TCS34725_ERR_INVALID_ARG);
+}
+
+
+int main(void) {
+    test_order_and_overlap();
+    test_free_running();
+    test_timeout();
+    test_mux_failure();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
@@ -0,0 +1,230 @@
+// Test of the transaction scripts against a fake bus.
+//
+// The fake bus is the simulator (tcs34725_sim.h) behind counting shims,
+// and scripts are submitted to a fake DMA backend that runs them later
+// from an "interrupt" through tcs34725_script_execute. The test checks
+// that the common sequences program the device, that samples land in the
+// caller's array with one transaction each, that completion is reported
+// through the callback, and that the register shadow and settings of the
+// config stay coherent with what the scripts wrote (including the
+// acquisition state after a power down). The exit status is non-zero if a
+// check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725.c src/tcs34725_sim.c src/tcs34725_script.c test/tcs34725_script_test.c -lm -o tcs34725_script_test
+
+#include <stdio.h>
+#include "tcs34725.h"
+#include "tcs34725_sim.h"
+#include "tcs34725_script.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+// Number of samples fetched into the caller's array
+#define SAMPLES (10)
+
+static tcs34725_sim_t sim;
+static uint32_t transactions;
+static int failures;
+
+// Fake DMA backend, one script in flight
+static const tcs34725_script_t*   pending;
+static tcs34725_script_done_fptr_t pending_done;
+static void*                      pending_done_ptr;
+static void*                      pending_user_ptr;
+
+// Completion results
+static uint32_t completions;
+static int8_t   last_result;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        printf("line %d: %s failed\n", line, what);
+        failures++;
+    }
+}
+
+
+static int8_t shim_read_reg(uint8_t reg_addr, uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    transactions++;
+    return tcs34725_sim_read_reg(reg_addr, reg_data, len, user_ptr);
+}
+
+
+static int8_t shim_write_reg(uint8_t reg_addr, const uint8_t* reg_data, uint32_t len, void* user_ptr) {
+    transactions++;
+    return tcs34725_sim_write_reg(reg_addr, reg_data, len, user_ptr);
+}
+
+
+static int8_t shim_write_byte(uint8_t single_byte, void* user_ptr) {
+    transactions++;
+    return tcs34725_sim_write_byte(single_byte, user_ptr);
+}
+
+
+static int8_t dma_submit(const tcs34725_script_t* script, tcs34725_script_done_fptr_t done, void* done_ptr, void* user_ptr) {
+    if(pending != NULL){
+        return -1;
+    }
+    pending = script;
+    pending_done = done;
+    pending_done_ptr = done_ptr;
+    pending_user_ptr = user_ptr;
+    return 0;
+}
+
+
+static void dma_irq(void) {
+    const tcs34725_script_t* script = pending;
+    pending = NULL;
+    tcs34725_script_execute(script, pending_done, pending_done_ptr, pending_user_ptr);
+}
+
+
+static void done(int8_t result, void* done_ptr) {
+    (void)done_ptr;
+    completions++;
+    last_result = result;
+}
+
+
+static void setup(tcs34725_config_t* config) {
+    tcs34725_sim_detach_all();
+    tcs34725_sim_init(&sim, TCS34725_ID);
+    tcs34725_sim_set_light(&sim, (tcs34725_sim_light_t){ .red = 1.0F, .green = 2.0F, .blue = 3.0F, .clear = 6.0F });
+    *config = (tcs34725_config_t){ 0 };
+    CHECK(tcs34725_sim_attach(&sim, config) == TCS34725_OK);
+    config->read_reg = shim_read_reg;
+    config->write_reg = shim_write_reg;
+    config->write_byte = shim_write_byte;
+    config->settings.integration_time = TCS34725_INTEGRATIONTIME_24MS;
+    config->settings.gain = TCS34725_GAIN_1X;
+    completions = 0;
+}
+
+
+static void run(const tcs34725_script_t* script, tcs34725_config_t* config) {
+    // Nothing happens on the bus until the completion "interrupt"
+    uint32_t before = transactions;
+    CHECK(dma_submit(script, done, NULL, config) == 0);
+    CHECK(transactions == before);
+    dma_irq();
+}
+
+
+static void test_sequences(void) {
+    static tcs34725_script_t configure, one_shot, fetch, rearm;
+    static tcs34725_color_t samples[SAMPLES];
+    static uint8_t status[SAMPLES];
+    tcs34725_config_t config;
+    setup(&config);
+    CHECK(tcs34725_init(&config) == TCS34725_OK);
+
+    const tcs34725_settings_t settings = { TCS34725_GAIN_4X, TCS34725_INTEGRATIONTIME_50MS };
+    tcs34725_script_reset(&configure);
+    CHECK(tcs34725_script_configure(&configure, settings) == TCS34725_OK);
+    tcs34725_script_reset(&one_shot);
+    CHECK(tcs34725_script_one_shot(&one_shot, settings.integration_time, false, &samples[0], &status[0]) == TCS34725_OK);
+    tcs34725_script_reset(&fetch);
+    CHECK(tcs34725_script_fetch(&fetch, &samples[0], &status[0]) == TCS34725_OK);
+    tcs34725_script_reset(&rearm);
+    CHECK(tcs34725_script_rearm(&rearm, 100, 2000) == TCS34725_OK);
+
+    // Reconfigure, the driver sees the new settings
+    run(&configure, &config);
+    CHECK(completions == 1 && last_result == 0);
+    CHECK(sim.regs[TCS34725_ATIME_REG] == TCS34725_INTEGRATIONTIME_50MS);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_4X);
+    CHECK(config.settings.integration_time == TCS34725_INTEGRATIONTIME_50MS);
+    CHECK(config.settings.gain == TCS34725_GAIN_4X);
+
+    // One shot, 21 cycles at 4x and the device powered down afterwards
+    run(&one_shot, &config);
+    CHECK(completions == 2 && last_result == 0);
+    CHECK(status[0] & TCS34727_FLAG_AVALID);
+    CHECK(samples[0].clear == 6 * 4 * 21 && samples[0].red == 1 * 4 * 21);
+    CHECK(samples[0].green == 2 * 4 * 21 && samples[0].blue == 3 * 4 * 21);
+    CHECK(sim.regs[TCS34725_ENABLE_REG] == 0);
+
+    // Samples land in the caller's array, one transaction each
+    CHECK(tcs34725_enable(&config) == TCS34725_OK);
+    for(int i = 0; i < SAMPLES; i++){
+        // One integration (50.4ms) between fetches
+        config.delay_ms(51);
+        tcs34725_script_retarget(&fetch, &samples[i], &status[i]);
+        uint32_t before = transactions;
+        run(&fetch, &config);
+        CHECK(transactions - before == 1);
+    }
+    CHECK(completions == 2 + SAMPLES && last_result == 0);
+    for(int i = 0; i < SAMPLES; i++){
+        CHECK((status[i] & TCS34727_FLAG_AVALID) && samples[i].clear == 6 * 4 * 21);
+    }
+
+    // New thresholds and an interrupt clear
+    run(&rearm, &config);
+    CHECK(last_result == 0);
+    CHECK(sim.regs[TCS34725_AILTL_REG] == (100 & 0xFF) && sim.regs[TCS34725_AILTH_REG] == (100 >> 8));
+    CHECK(sim.regs[TCS34725_AIHTL_REG] == (2000 & 0xFF) && sim.regs[TCS34725_AIHTH_REG] == (2000 >> 8));
+}
+
+
+static void test_shadow(void) {
+    static tcs34725_script_t configure;
+    tcs34725_config_t config;
+    setup(&config);
+    CHECK(tcs34725_init(&config) == TCS34725_OK);
+
+    // A script changes the gain behind the driver, setting it back must reach the device
+    const tcs34725_settings_t settings = { TCS34725_GAIN_60X, TCS34725_INTEGRATIONTIME_24MS };
+    tcs34725_script_reset(&configure);
+    CHECK(tcs34725_script_configure(&configure, settings) == TCS34725_OK);
+    run(&configure, &config);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_60X);
+    CHECK(tcs34725_set_gain(TCS34725_GAIN_1X, &config) == TCS34725_OK);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_1X);
+
+    // The register the failed step addressed is no longer trusted
+    sim.fail_next = 1;
+    run(&configure, &config);
+    CHECK(last_result != 0);
+    CHECK(!(config.state.shadow_valid & (1U << TCS34725_ATIME_REG)));
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_1X);
+    run(&configure, &config);
+    CHECK(last_result == 0);
+    CHECK(sim.regs[TCS34725_CONTROL_REG] == TCS34725_GAIN_60X);
+    CHECK(config.state.shadow[TCS34725_CONTROL_REG] == TCS34725_GAIN_60X);
+}
+
+
+static void test_one_shot_state(void) {
+    static tcs34725_script_t one_shot;
+    tcs34725_color_t color;
+    uint8_t status = 0;
+    tcs34725_config_t config;
+    setup(&config);
+    CHECK(tcs34725_init(&config) == TCS34725_OK);
+    CHECK(tcs34725_set_interrupt(true, &config) == TCS34725_OK);
+    CHECK(tcs34725_start(&config) == TCS34725_OK);
+    CHECK(config.state.acquisition != TCS34725_STATE_IDLE);
+
+    // The interrupt enable survives the power down, the driver sees the device idle
+    tcs34725_script_reset(&one_shot);
+    CHECK(tcs34725_script_one_shot(&one_shot, config.settings.integration_time, true, &color, &status) == TCS34725_OK);
+    run(&one_shot, &config);
+    CHECK(last_result == 0);
+    CHECK(status & TCS34727_FLAG_AVALID);
+    CHECK(sim.regs[TCS34725_ENABLE_REG] == TCS34725_ENABLE_AIEN);
+    CHECK(config.state.shadow[TCS34725_ENABLE_REG] == TCS34725_ENABLE_AIEN);
+    CHECK(config.state.acquisition == TCS34725_STATE_IDLE);
+}
+
+
+int main(void) {
+    test_sequences();
+    test_shadow();
+    test_one_shot_state();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}
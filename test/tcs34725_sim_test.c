@@ -0,0 +1,237 @@
+// Test of the simulator timing model.
+//
+// The other tests and the benchmark depend on the simulator behaving like
+// the device, so its model is pinned here through the raw register
+// interface: the 2.4ms PON warm-up, integration length from ATIME, the wait
+// timer (WTIME, WLONG), sticky AVALID, AINT persistence filtering, data
+// latching, saturation, and the shared virtual clock of attached
+// simulators. The exit status is non-zero if a check fails.
+//
+// Build: cc -O2 -Iinc src/tcs34725_sim.c test/tcs34725_sim_test.c -o tcs34725_sim_test
+
+#include <stdio.h>
+#include "tcs34725_sim.h"
+
+#define CHECK(cond) check((cond), #cond, __LINE__)
+
+static tcs34725_sim_t sim;
+static int failures;
+
+
+static void check(bool ok, const char* what, int line) {
+    if(!ok){
+        printf("line %d: %s failed\n", line, what);
+        failures++;
+    }
+}
+
+
+static void write8(uint8_t reg, uint8_t value) {
+    CHECK(tcs34725_sim_write_reg(reg, &value, 1, &sim) == 0);
+}
+
+
+static uint8_t status(void) {
+    uint8_t value = 0;
+    CHECK(tcs34725_sim_read_reg(TCS34725_STATUS_REG, &value, 1, &sim) == 0);
+    return value;
+}
+
+
+static uint16_t clear(void) {
+    uint8_t data[2] = { 0, 0 };
+    CHECK(tcs34725_sim_read_reg(TCS34725_CDATAL_REG, data, 2, &sim) == 0);
+    return (uint16_t)(data[0] | (data[1] << 8));
+}
+
+
+static void setup(void) {
+    static tcs34725_config_t config;
+    tcs34725_sim_detach_all();
+    tcs34725_sim_init(&sim, TCS34725_ID);
+    tcs34725_sim_set_light(&sim, (tcs34725_sim_light_t){ .red = 1.0F, .green = 2.0F, .blue = 3.0F, .clear = 10.0F });
+    CHECK(tcs34725_sim_attach(&sim, &config) == TCS34725_OK);
+}
+
+
+static void test_integration(void) {
+    setup();
+    write8(TCS34725_ATIME_REG, TCS34725_INTEGRATIONTIME_24MS);
+
+    // PON and AEN together, the integration starts after the 2.4ms warm-up
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+    CHECK(sim.phase == TCS34725_SIM_WARMUP);
+    tcs34725_sim_advance_us(&sim, 2400 + 24000 - 1);
+    CHECK(!(status() & TCS34727_FLAG_AVALID));
+    tcs34725_sim_advance_us(&sim, 1);
+    CHECK(status() & TCS34727_FLAG_AVALID);
+    CHECK(sim.cycles == 1);
+    CHECK(clear() == 10 * 10);
+
+    // Back to back integrations of 10 cycles, AVALID stays set
+    tcs34725_sim_advance_us(&sim, 24000 * 3);
+    CHECK(sim.cycles == 4);
+    CHECK(status() & TCS34727_FLAG_AVALID);
+
+    // Clearing AEN clears AVALID, AEN after the warm-up starts immediately
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON);
+    CHECK(!(status() & TCS34727_FLAG_AVALID));
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+    CHECK(sim.phase == TCS34725_SIM_INTEGRATING);
+    tcs34725_sim_advance_us(&sim, 24000);
+    CHECK(sim.cycles == 5);
+
+    // Power down clears AVALID, power up needs the warm-up again
+    write8(TCS34725_ENABLE_REG, 0);
+    CHECK(!(status() & TCS34727_FLAG_AVALID));
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON);
+    tcs34725_sim_advance_us(&sim, 1000);
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+    CHECK(sim.phase == TCS34725_SIM_WARMUP);
+    tcs34725_sim_advance_us(&sim, 1400 + 24000);
+    CHECK(sim.cycles == 6);
+}
+
+
+static void test_wait(void) {
+    setup();
+    write8(TCS34725_ATIME_REG, TCS34725_INTEGRATIONTIME_2_4MS);
+    write8(TCS34725_WTIME_REG, 0xFE);   // 2 wait steps
+
+    // 2.4ms integration followed by 4.8ms wait
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON);
+    tcs34725_sim_advance_us(&sim, 2400);
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN | TCS34725_ENABLE_WEN);
+    tcs34725_sim_advance_us(&sim, 2400);
+    CHECK(sim.cycles == 1);
+    CHECK(sim.phase == TCS34725_SIM_WAITING);
+    tcs34725_sim_advance_us(&sim, 4800 + 2400 - 1);
+    CHECK(sim.cycles == 1);
+    tcs34725_sim_advance_us(&sim, 1);
+    CHECK(sim.cycles == 2);
+
+    // WLONG makes every wait step 12x longer (57.6ms)
+    write8(TCS34725_CONFIG_REG, TCS34725_CONFIG_WLONG);
+    tcs34725_sim_advance_us(&sim, 4800 + 2400);
+    CHECK(sim.cycles == 3);
+    tcs34725_sim_advance_us(&sim, 57600 + 2400 - 1);
+    CHECK(sim.cycles == 3);
+    tcs34725_sim_advance_us(&sim, 1);
+    CHECK(sim.cycles == 4);
+}
+
+
+static void test_persistence(void) {
+    setup();
+    write8(TCS34725_ATIME_REG, TCS34725_INTEGRATIONTIME_2_4MS);
+    // Window 5-20 around a clear value of 10
+    const uint8_t limits[4] = { 5, 0, 20, 0 };
+    CHECK(tcs34725_sim_write_reg(TCS34725_AILTL_REG, limits, sizeof(limits), &sim) == 0);
+    const uint8_t clear_int = TCS34725_COMMAND_FORMAT(TCS34725_COMMAND_BIT, TCS34725_SF_MODE, TCS34725_SF_INT_CLEAR);
+
+    // PERS_NONE: every cycle raises AINT, even inside the window
+    write8(TCS34725_PERS_REG, TCS34725_PERS_NONE);
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+    tcs34725_sim_advance_us(&sim, 2400 + 2400);
+    CHECK(status() & TCS34727_FLAG_AINT);
+    // The INT pin needs AIEN
+    CHECK(!tcs34725_sim_int_pin(&sim));
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN | TCS34725_ENABLE_AIEN);
+    CHECK(tcs34725_sim_int_pin(&sim));
+    CHECK(tcs34725_sim_write_byte(clear_int, &sim) == 0);
+    CHECK(!(status() & TCS34727_FLAG_AINT));
+
+    // PERS_2_CYCLE: inside the window never, outside after the second cycle
+    write8(TCS34725_PERS_REG, TCS34725_PERS_2_CYCLE);
+    tcs34725_sim_advance_us(&sim, 2400 * 5);
+    CHECK(!(status() & TCS34727_FLAG_AINT));
+    sim.light.clear = 30.0F;
+    tcs34725_sim_advance_us(&sim, 2400);
+    CHECK(!(status() & TCS34727_FLAG_AINT));
+    tcs34725_sim_advance_us(&sim, 2400);
+    CHECK(status() & TCS34727_FLAG_AINT);
+    CHECK(tcs34725_sim_write_byte(clear_int, &sim) == 0);
+
+    // PERS_5_CYCLE (APERS 4), an in-window sample restarts the count
+    write8(TCS34725_PERS_REG, TCS34725_PERS_5_CYCLE);
+    sim.light.clear = 10.0F;
+    tcs34725_sim_advance_us(&sim, 2400);
+    sim.light.clear = 30.0F;
+    tcs34725_sim_advance_us(&sim, 2400 * 4);
+    CHECK(!(status() & TCS34727_FLAG_AINT));
+    tcs34725_sim_advance_us(&sim, 2400);
+    CHECK(status() & TCS34727_FLAG_AINT);
+}
+
+
+static void test_data(void) {
+    setup();
+    write8(TCS34725_ATIME_REG, TCS34725_INTEGRATIONTIME_24MS);
+    write8(TCS34725_CONTROL_REG, TCS34725_GAIN_16X);
+    write8(TCS34725_ENABLE_REG, TCS34725_ENABLE_PON | TCS34725_ENABLE_AEN);
+    tcs34725_sim_advance_us(&sim, 2400 + 24000);
+
+    // Status and all channels in one auto-increment read
+    uint8_t data[9];
+    CHECK(tcs34725_sim_read_reg(TCS34725_STATUS_REG, data, sizeof(data), &sim) == 0);
+    CHECK((data[1] | (data[2] << 8)) == 10 * 16 * 10);
+    CHECK((data[3] | (data[4] << 8)) == 1 * 16 * 10);
+    CHECK((data[5] | (data[6] << 8)) == 2 * 16 * 10);
+    CHECK((data[7] | (data[8] << 8)) == 3 * 16 * 10);
+
+    // Reading the low byte latches the high byte until it is read
+    uint8_t low = 0, high = 0;
+    CHECK(tcs34725_sim_read_reg(TCS34725_CDATAL_REG, &low, 1, &sim) == 0);
+    sim.light.clear = 50.0F;
+    tcs34725_sim_advance_us(&sim, 24000);
+    CHECK(tcs34725_sim_read_reg(TCS34725_CDATAH_REG, &high, 1, &sim) == 0);
+    CHECK((low | (high << 8)) == 10 * 16 * 10);
+    CHECK(clear() == 50 * 16 * 10);
+
+    // Analog saturation at 1024 counts per cycle, digital at 65535
+    sim.light.clear = 1000.0F;
+    tcs34725_sim_advance_us(&sim, 24000);
+    CHECK(clear() == 1024 * 10);
+    write8(TCS34725_ATIME_REG, TCS34725_INTEGRATIONTIME_700MS);
+    tcs34725_sim_advance_us(&sim, 24000 + 614400);
+    CHECK(clear() == 65535);
+
+    // Injected bus failures
+    sim.fail_next = 1;
+    CHECK(tcs34725_sim_read_reg(TCS34725_STATUS_REG, data, 1, &sim) != 0);
+    CHECK(tcs34725_sim_read_reg(TCS34725_STATUS_REG, data, 1, &sim) == 0);
+}
+
+
+static void test_clock(void) {
+    static tcs34725_sim_t sims[TCS34725_SIM_MAX_DEVICES + 1];
+    static tcs34725_config_t configs[TCS34725_SIM_MAX_DEVICES + 1];
+    tcs34725_sim_detach_all();
+
+    // Attached simulators share the clock, one too many is refused
+    for(int i = 0; i <= TCS34725_SIM_MAX_DEVICES; i++){
+        tcs34725_sim_init(&sims[i], TCS34725_ID);
+        configs[i] = (tcs34725_config_t){ 0 };
+        tcs34725_err_t err = tcs34725_sim_attach(&sims[i], &configs[i]);
+        CHECK(err == ((i < TCS34725_SIM_MAX_DEVICES) ? TCS34725_OK : TCS34725_ERR_INVALID_ARG));
+    }
+    CHECK(configs[TCS34725_SIM_MAX_DEVICES].read_reg == NULL);
+    // Attaching again is not a new device
+    CHECK(tcs34725_sim_attach(&sims[0], &configs[0]) == TCS34725_OK);
+
+    configs[0].delay_ms(25);
+    CHECK(configs[0].get_tick_ms() == 25);
+    CHECK(sims[TCS34725_SIM_MAX_DEVICES - 1].time_us == 25000);
+    CHECK(sims[TCS34725_SIM_MAX_DEVICES].time_us == 0);
+}
+
+
+int main(void) {
+    test_integration();
+    test_wait();
+    test_persistence();
+    test_data();
+    test_clock();
+    printf("%s\n", (failures == 0) ? "PASS" : "FAIL");
+    return (failures == 0) ? 0 : 1;
+}